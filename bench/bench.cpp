@@ -1,20 +1,58 @@
 #include <benchmark/benchmark.h>
 
 #include <clickhouse/client.h>
+#include <clickhouse/base/compressed.h>
+#include <clickhouse/base/wire_format.h>
+#include <clickhouse/columns/lowcardinality.h>
+#include <clickhouse/columns/string.h>
+
+#include "../ut/utils.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> g_allocations{0};
+
+}
+
+/// Replaced to count allocations.
+void* operator new(size_t size) {
+    ++g_allocations;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
 
 namespace clickhouse {
 
-Client g_client(ClientOptions()
-        .SetHost(           getEnvOrDefault("CLICKHOUSE_HOST",     "localhost"))
-        .SetPort( std::stoi(getEnvOrDefault("CLICKHOUSE_PORT",     "9000")))
-        .SetUser(           getEnvOrDefault("CLICKHOUSE_USER",     "default"))
-        .SetPassword(       getEnvOrDefault("CLICKHOUSE_PASSWORD", ""))
-        .SetDefaultDatabase(getEnvOrDefault("CLICKHOUSE_DB",       "default"))
-        .SetPingBeforeQuery(false));
+/// Connection is established by the first benchmark which needs it,
+/// so the benchmarks not involving a server could be run without one.
+Client& GetClient() {
+    static Client client(ClientOptions()
+            .SetHost(           getEnvOrDefault("CLICKHOUSE_HOST",     "localhost"))
+            .SetPort( std::stoi(getEnvOrDefault("CLICKHOUSE_PORT",     "9000")))
+            .SetUser(           getEnvOrDefault("CLICKHOUSE_USER",     "default"))
+            .SetPassword(       getEnvOrDefault("CLICKHOUSE_PASSWORD", ""))
+            .SetDefaultDatabase(getEnvOrDefault("CLICKHOUSE_DB",       "default"))
+            .SetPingBeforeQuery(false));
+    return client;
+}
 
 static void SelectNumber(benchmark::State& state) {
     while (state.KeepRunning()) {
-        g_client.Select("SELECT number, number, number FROM system.numbers LIMIT 1000",
+        GetClient().Select("SELECT number, number, number FROM system.numbers LIMIT 1000",
             [](const Block& block) { block.GetRowCount(); }
         );
     }
@@ -24,7 +62,7 @@ BENCHMARK(SelectNumber);
 static void SelectNumberMoreColumns(benchmark::State& state) {
     // Mainly test performance on type name parsing.
     while (state.KeepRunning()) {
-        g_client.Select("SELECT "
+        GetClient().Select("SELECT "
                 "number, number, number, number, number, number, number, number, number, number "
                 "FROM system.numbers LIMIT 100",
             [](const Block& block) { block.GetRowCount(); }
@@ -33,6 +71,81 @@ static void SelectNumberMoreColumns(benchmark::State& state) {
 }
 BENCHMARK(SelectNumberMoreColumns);
 
+/// Decoding of compressed frames of state.range(0) bytes, as they are received from the server.
+static void DecompressFrames(benchmark::State& state) {
+    const size_t frame_size = state.range(0);
+    const size_t frames = std::max<size_t>(1, (8 << 20) / frame_size);
+
+    Buffer data(frame_size);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i % 251 + i / 4096);
+    }
+
+    Buffer stream;
+    {
+        BufferOutput output(&stream);
+        CompressedOutput compressed(&output, frame_size);
+        for (size_t i = 0; i < frames; ++i) {
+            compressed.Write(data.data(), data.size());
+        }
+        compressed.Flush();
+    }
+
+    Buffer result(frame_size);
+    size_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        BufferedInput input(std::make_unique<ArrayInput>(stream.data(), stream.size()));
+        CompressedInput compressed(&input);
+        // Warm up, so only the allocations of the steady state are counted.
+        WireFormat::ReadBytes(compressed, result.data(), result.size());
+        const size_t allocations_before = g_allocations;
+        state.ResumeTiming();
+
+        for (size_t i = 1; i < frames; ++i) {
+            WireFormat::ReadBytes(compressed, result.data(), result.size());
+        }
+
+        allocations += g_allocations - allocations_before;
+    }
+
+    state.SetBytesProcessed(state.iterations() * frame_size * (frames - 1));
+    state.counters["allocations_per_frame"] = benchmark::Counter(
+        static_cast<double>(allocations) / (state.iterations() * (frames - 1)));
+}
+BENCHMARK(DecompressFrames)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+/// Decoding of a block of LowCardinality(String) column with state.range(0) distinct values.
+static void LoadLowCardinalityString(benchmark::State& state) {
+    const size_t distinct = state.range(0);
+    const size_t rows = 1 << 20;
+
+    ColumnLowCardinalityT<ColumnString> column;
+    for (size_t i = 0; i < rows; ++i) {
+        column.Append("value " + std::to_string(i % distinct));
+    }
+
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        column.Save(&output);
+        output.Flush();
+    }
+
+    for (auto _ : state) {
+        ArrayInput input(data.data(), data.size());
+        ColumnLowCardinalityT<ColumnString> loaded;
+        if (!loaded.Load(&input, rows)) {
+            state.SkipWithError("failed to load column");
+            break;
+        }
+        benchmark::DoNotOptimize(loaded.Size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(LoadLowCardinalityString)->Arg(100)->Arg(10000)->Arg(1000000);
+
 }
 
 BENCHMARK_MAIN();
@@ -1,17 +1,26 @@
 #include "compressed.h"
 #include "wire_format.h"
 #include "output.h"
+#include "thread_pool.h"
 #include "../exceptions.h"
 
 #include <city.h>
 #include <lz4.h>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <stdexcept>
 #include <system_error>
+#include <thread>
+
+#if defined(WITH_ZSTD)
+#include <zstd.h>
+#endif
 
 namespace {
+constexpr size_t HASH_SIZE = 16;
 constexpr size_t HEADER_SIZE = 9;
-// see DB::CompressionMethodByte::LZ4 from src/Compression/CompressionInfo.h of ClickHouse project
-constexpr uint8_t COMPRESSION_METHOD = 0x82;
 // Documentation says that compression is faster when output buffer is larger than LZ4_compressBound estimation.
 constexpr size_t EXTRA_COMPRESS_BUFFER_SIZE = 4096;
 constexpr size_t DBMS_MAX_COMPRESSED_SIZE = 0x40000000ULL;   // 1GB
@@ -19,20 +28,213 @@ constexpr size_t DBMS_MAX_COMPRESSED_SIZE = 0x40000000ULL;   // 1GB
 
 namespace clickhouse {
 
+#if defined(WITH_ZSTD)
+struct CompressedInput::ZSTDContext {
+    ZSTDContext()
+        : dctx(ZSTD_createDCtx())
+    {
+        if (!dctx) {
+            throw ZSTDError("can't create ZSTD decompression context");
+        }
+    }
+
+    ~ZSTDContext() {
+        ZSTD_freeDCtx(dctx);
+    }
+
+    ZSTD_DCtx* const dctx;
+};
+
+struct CompressedOutput::ZSTDContext {
+    ZSTDContext()
+        : cctx(ZSTD_createCCtx())
+    {
+        if (!cctx) {
+            throw ZSTDError("can't create ZSTD compression context");
+        }
+    }
+
+    ~ZSTDContext() {
+        ZSTD_freeCCtx(cctx);
+    }
+
+    ZSTD_CCtx* const cctx;
+};
+#else
+struct CompressedInput::ZSTDContext {};
+struct CompressedOutput::ZSTDContext {};
+#endif
+
+/// Decompresses frames following the current one in the buffer of the source on a thread of its own.
+struct CompressedInput::ReadAhead {
+    struct Frame {
+        /// Position of the frame (including its checksum) in the buffer of the source.
+        const uint8_t* position = nullptr;
+        size_t size = 0;
+        Buffer data;
+        size_t original = 0;
+    };
+
+    explicit ReadAhead(size_t max_frames)
+        : max_frames(max_frames)
+        , thread(&ReadAhead::Run, this)
+    {
+    }
+
+    ~ReadAhead() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    /// Starts decoding frames from the data at [begin, end), unless previously decoded frames are not consumed yet.
+    void Schedule(const uint8_t* begin, const uint8_t* end) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cursor != last || !ready.empty()) {
+                return;
+            }
+            cursor = begin;
+            last = end;
+        }
+        changed.notify_all();
+    }
+
+    /// Takes the frame decoded at \p position, if any, waiting for it if it is about to be decoded.
+    bool Take(const uint8_t* position, Frame* frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        // The frame is yet to be decoded if it is at the cursor and nothing is decoded before it.
+        changed.wait(lock, [&] () {
+            return !ready.empty() || cursor != position || cursor == last;
+        });
+
+        if (ready.empty() || ready.front().position != position) {
+            return false;
+        }
+
+        *frame = std::move(ready.front());
+        ready.pop_front();
+        lock.unlock();
+        changed.notify_all();
+
+        return true;
+    }
+
+    /// Returns a buffer of a consumed frame to be reused.
+    void Recycle(Buffer&& buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(std::move(buffer));
+    }
+
+    /// Drops the decoded frames, waits until the buffer of the source is not accessed anymore.
+    void Cancel() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cursor = last = nullptr;
+        changed.wait(lock, [this] () { return !busy; });
+
+        for (auto& frame : ready) {
+            spare.push_back(std::move(frame.data));
+        }
+        ready.clear();
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true) {
+            changed.wait(lock, [this] () {
+                return stop || (cursor != last && ready.size() < max_frames);
+            });
+            if (stop) {
+                break;
+            }
+
+            const uint8_t* const position = cursor;
+            const size_t available = last - cursor;
+            Buffer data;
+            if (!spare.empty()) {
+                data = std::move(spare.back());
+                spare.pop_back();
+            }
+            busy = true;
+            lock.unlock();
+
+            size_t size = 0;
+            size_t original = 0;
+            // Bytes following the frame are not necessarily a frame, e.g. the next packet of the protocol,
+            // which is caught by the checksum. Any failure stops the read-ahead, since the frame
+            // is going to be decoded again by the reader, which reports the error if there is one.
+            try {
+                if (available >= HASH_SIZE + HEADER_SIZE) {
+                    const FrameHeader header = ParseHeader(position + HASH_SIZE);
+                    size = HASH_SIZE + header.compressed;
+                    if (size <= available) {
+                        DecompressFrame(position, position + HASH_SIZE, header, data, zstd);
+                        original = header.original;
+                    } else {
+                        size = 0;
+                    }
+                }
+            } catch (const std::exception&) {
+                size = 0;
+            }
+
+            lock.lock();
+            busy = false;
+            if (size && cursor == position) {
+                ready.push_back(Frame{position, size, std::move(data), original});
+                cursor += size;
+            } else {
+                if (cursor == position) {
+                    cursor = last = nullptr;
+                }
+                spare.push_back(std::move(data));
+            }
+            changed.notify_all();
+        }
+    }
+
+    const size_t max_frames;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    /// Data yet to be decoded.
+    const uint8_t* cursor = nullptr;
+    const uint8_t* last = nullptr;
+    /// The frame at `cursor` is being decoded.
+    bool busy = false;
+    bool stop = false;
+    std::deque<Frame> ready;
+    std::vector<Buffer> spare;
+    /// Used by the thread only.
+    std::unique_ptr<ZSTDContext> zstd;
+
+    std::thread thread;
+};
+
 CompressedInput::CompressedInput(InputStream* input)
     : input_(input)
+    , zero_copy_input_(dynamic_cast<ZeroCopyInput*>(input))
+    , buffered_input_(nullptr)
 {
 }
 
-CompressedInput::~CompressedInput() {
-    if (!mem_.Exhausted()) {
-#if __cplusplus < 201703L
-        if (!std::uncaught_exception()) {
-#else
-        if (!std::uncaught_exceptions()) {
-#endif
-            throw LZ4Error("some data was not read");
-        }
+CompressedInput::CompressedInput(BufferedInput* input, size_t read_ahead_frames)
+    : input_(input)
+    , zero_copy_input_(input)
+    , buffered_input_(input)
+    , read_ahead_(read_ahead_frames ? std::make_unique<ReadAhead>(read_ahead_frames) : nullptr)
+{
+}
+
+CompressedInput::~CompressedInput() = default;
+
+void CompressedInput::StopReadAhead() {
+    if (read_ahead_) {
+        read_ahead_->Cancel();
     }
 }
 
@@ -46,69 +248,213 @@ size_t CompressedInput::DoNext(const void** ptr, size_t len) {
     return mem_.Next(ptr, len);
 }
 
-bool CompressedInput::Decompress() {
-    uint128 hash;
-    uint32_t compressed = 0;
-    uint32_t original = 0;
-    uint8_t method = 0;
-
-    if (!WireFormat::ReadFixed(*input_, &hash)) {
-        return false;
+size_t CompressedInput::DoPeek(const void** ptr, size_t len) {
+    if (mem_.Exhausted()) {
+        if (!Decompress()) {
+            return 0;
+        }
     }
-    if (!WireFormat::ReadFixed(*input_, &method)) {
-        return false;
+
+    return mem_.Peek(ptr, len);
+}
+
+void CompressedInput::DoConsume(size_t len) {
+    mem_.Consume(len);
+}
+
+bool CompressedInput::Decompress() {
+    if (!read_ahead_) {
+        return DecompressNext();
     }
 
-    if (method != COMPRESSION_METHOD) {
-        throw LZ4Error("unsupported compression method " + std::to_string(int(method)));
+    ReadAhead::Frame frame;
+    if (read_ahead_->Take(buffered_input_->BufferedData(), &frame)) {
+        // The frame is still in the buffer of the source, so it is skipped without a read.
+        zero_copy_input_->Skip(frame.size);
+        std::swap(data_, frame.data);
+        read_ahead_->Recycle(std::move(frame.data));
+        mem_.Reset(data_.data(), frame.original);
     } else {
-        if (!WireFormat::ReadFixed(*input_, &compressed)) {
-            return false;
-        }
-        if (!WireFormat::ReadFixed(*input_, &original)) {
+        // The source is about to be read, so its buffer is going to be overwritten.
+        read_ahead_->Cancel();
+        if (!DecompressNext()) {
             return false;
         }
+    }
 
-        if (compressed > DBMS_MAX_COMPRESSED_SIZE) {
-            throw LZ4Error("compressed data too big");
-        }
+    // Frames following the current one are decoded while the current one is consumed.
+    read_ahead_->Schedule(buffered_input_->BufferedData(),
+            buffered_input_->BufferedData() + buffered_input_->BufferedSize());
+
+    return true;
+}
 
-        Buffer tmp(compressed);
+bool CompressedInput::DecompressNext() {
+    uint8_t hash[HASH_SIZE];
+    uint8_t header_bytes[HEADER_SIZE];
+    // Header and compressed data, contiguous in memory.
+    const uint8_t* frame = nullptr;
+    // Set if the header is still available in the buffer of the input stream.
+    const uint8_t* header_in_place = nullptr;
 
-        // Заполнить заголовок сжатых данных.
-        {
-            BufferOutput out(&tmp);
-            out.Write(&method,     sizeof(method));
-            out.Write(&compressed, sizeof(compressed));
-            out.Write(&original,   sizeof(original));
-            out.Flush();
+    if (!WireFormat::ReadBytes(*input_, hash, HASH_SIZE)) {
+        return false;
+    }
+
+    if (zero_copy_input_) {
+        const void* ptr = nullptr;
+        const size_t size = zero_copy_input_->Next(&ptr, HEADER_SIZE);
+        if (size == 0) {
+            return false;
         }
+        memcpy(header_bytes, ptr, size);
 
-        if (!WireFormat::ReadBytes(*input_, tmp.data() + HEADER_SIZE, compressed - HEADER_SIZE)) {
+        if (size == HEADER_SIZE) {
+            header_in_place = static_cast<const uint8_t*>(ptr);
+        } else if (!WireFormat::ReadBytes(*input_, header_bytes + size, HEADER_SIZE - size)) {
             return false;
-        } else {
-            if (hash != CityHash128((const char*)tmp.data(), compressed)) {
-                throw LZ4Error("data was corrupted");
-            }
         }
+    } else if (!WireFormat::ReadBytes(*input_, header_bytes, HEADER_SIZE)) {
+        return false;
+    }
 
-        data_ = Buffer(original);
+    const FrameHeader header = ParseHeader(header_bytes);
+    const size_t source_size = header.compressed - HEADER_SIZE;
 
-        if (LZ4_decompress_safe((const char*)tmp.data() + HEADER_SIZE, (char*)data_.data(), compressed - HEADER_SIZE, original) < 0) {
-            throw LZ4Error("can't decompress data");
+    if (header_in_place) {
+        // The whole frame may be already in the buffer of the input stream,
+        // then it is checked and decompressed right there.
+        const void* ptr = nullptr;
+        const size_t size = source_size ? zero_copy_input_->Next(&ptr, source_size) : 0;
+
+        if (size == source_size && (size == 0 || ptr == header_in_place + HEADER_SIZE)) {
+            frame = header_in_place;
         } else {
-            mem_.Reset(data_.data(), original);
+            if (tmp_.size() < header.compressed) {
+                tmp_.resize(header.compressed);
+            }
+            memcpy(tmp_.data(), header_bytes, HEADER_SIZE);
+            if (size) {
+                memcpy(tmp_.data() + HEADER_SIZE, ptr, size);
+            }
+            if (!WireFormat::ReadBytes(*input_, tmp_.data() + HEADER_SIZE + size, source_size - size)) {
+                return false;
+            }
+            frame = tmp_.data();
         }
+    } else {
+        if (tmp_.size() < header.compressed) {
+            tmp_.resize(header.compressed);
+        }
+        memcpy(tmp_.data(), header_bytes, HEADER_SIZE);
+        if (!WireFormat::ReadBytes(*input_, tmp_.data() + HEADER_SIZE, source_size)) {
+            return false;
+        }
+        frame = tmp_.data();
     }
 
+    DecompressFrame(hash, frame, header, data_, zstd_);
+    mem_.Reset(data_.data(), header.original);
+
     return true;
 }
 
+CompressedInput::FrameHeader CompressedInput::ParseHeader(const uint8_t* header) {
+    FrameHeader result;
+    memcpy(&result.method, header, sizeof(result.method));
+    memcpy(&result.compressed, header + 1, sizeof(result.compressed));
+    memcpy(&result.original, header + 5, sizeof(result.original));
+
+    if (result.method != CompressionMethodByte::NONE && result.method != CompressionMethodByte::LZ4
+            && result.method != CompressionMethodByte::ZSTD) {
+        throw CompressionError("unsupported compression method " + std::to_string(int(result.method)));
+    }
+    if (result.compressed > DBMS_MAX_COMPRESSED_SIZE) {
+        throw CompressionError("compressed data too big");
+    }
+    if (result.compressed < HEADER_SIZE) {
+        throw CompressionError("compressed data too small");
+    }
+
+    return result;
+}
+
+void CompressedInput::DecompressFrame(const uint8_t* hash, const uint8_t* frame, const FrameHeader& header,
+                                      Buffer& data, std::unique_ptr<ZSTDContext>& zstd) {
+    // The checksum is stored as the low and the high halves of uint128.
+    uint64_t expected[2];
+    memcpy(expected, hash, sizeof(expected));
+    const uint128 actual = CityHash128((const char*)frame, header.compressed);
+    if (expected[0] != Uint128Low64(actual) || expected[1] != Uint128High64(actual)) {
+        throw CompressionError("data was corrupted");
+    }
+
+    // Grows only, so there are no allocations once the largest frame is received.
+    if (data.size() < header.original) {
+        data.resize(header.original);
+    }
+
+    const char* source = (const char*)frame + HEADER_SIZE;
+    const size_t source_size = header.compressed - HEADER_SIZE;
+    const size_t original = header.original;
+
+    switch (header.method) {
+        case CompressionMethodByte::NONE: {
+            if (source_size != original) {
+                throw CompressionError("size of uncompressed data mismatch");
+            }
+            if (original) {
+                memcpy(data.data(), source, original);
+            }
+            break;
+        }
+        case CompressionMethodByte::LZ4: {
+            if (LZ4_decompress_safe(source, (char*)data.data(), source_size, original) < 0) {
+                throw LZ4Error("can't decompress data");
+            }
+            break;
+        }
+        case CompressionMethodByte::ZSTD: {
+#if defined(WITH_ZSTD)
+            if (!zstd) {
+                zstd = std::make_unique<ZSTDContext>();
+            }
+            const size_t result = ZSTD_decompressDCtx(zstd->dctx, data.data(), original, source, source_size);
+            if (ZSTD_isError(result)) {
+                throw ZSTDError(std::string("can't decompress data: ") + ZSTD_getErrorName(result));
+            }
+            if (result != original) {
+                throw ZSTDError("size of decompressed data mismatch");
+            }
+            break;
+#else
+            (void)zstd;
+            throw CompressionError("library was built with no ZSTD support");
+#endif
+        }
+    }
+}
+
 
-CompressedOutput::CompressedOutput(OutputStream * destination, size_t max_compressed_chunk_size)
+CompressedOutput::CompressedOutput(OutputStream * destination, size_t max_compressed_chunk_size,
+                                   CompressionMethod method, int level, ThreadPool* pool)
     : destination_(destination)
     , max_compressed_chunk_size_(max_compressed_chunk_size)
+    , method_(method)
+    , level_(level)
+    , pool_(pool && pool->GetThreadCount() > 1 ? pool : nullptr)
+    , zstd_(pool_ ? pool_->GetThreadCount() : 1)
 {
+    if (method_ != CompressionMethod::LZ4 && method_ != CompressionMethod::ZSTD) {
+        throw ValidationError("unsupported compression method " + std::to_string(static_cast<int>(method_)));
+    }
+#if !defined(WITH_ZSTD)
+    (void)level_;
+    if (method_ == CompressionMethod::ZSTD) {
+        throw CompressionError("library was built with no ZSTD support");
+    }
+#endif
+
     PreallocateCompressBuffer(max_compressed_chunk_size);
 }
 
@@ -118,13 +464,21 @@ size_t CompressedOutput::DoWrite(const void* data, size_t len) {
     const size_t original_len = len;
     // what if len > max_compressed_chunk_size_ ?
     const size_t max_chunk_size = max_compressed_chunk_size_ > 0 ? max_compressed_chunk_size_ : len;
+
+    if (pool_ && len > max_chunk_size) {
+        CompressParallel(data, len, max_chunk_size);
+        return original_len;
+    }
+
     if (max_chunk_size > max_compressed_chunk_size_) {
         PreallocateCompressBuffer(len);
     }
 
     while (len > 0) {
         auto to_compress = std::min(len, max_chunk_size);
-        Compress(data, to_compress);
+        const size_t frame_size = CompressFrame(data, to_compress, compressed_buffer_, zstd_[0]);
+        WireFormat::WriteBytes(*destination_, compressed_buffer_.data(), frame_size);
+        destination_->Flush();
 
         len -= to_compress;
         data = reinterpret_cast<const char*>(data) + to_compress;
@@ -137,38 +491,102 @@ void CompressedOutput::DoFlush() {
     destination_->Flush();
 }
 
-void CompressedOutput::Compress(const void * data, size_t len) {
-    const auto compressed_size = LZ4_compress_default(
-            (const char*)data,
-            (char*)compressed_buffer_.data() + HEADER_SIZE,
-            len,
-            static_cast<int>(compressed_buffer_.size() - HEADER_SIZE));
-    if (compressed_size <= 0)
-        throw LZ4Error("Failed to compress chunk of " + std::to_string(len) + " bytes, "
-                "LZ4 error: " + std::to_string(compressed_size));
+void CompressedOutput::CompressParallel(const void* data, size_t len, size_t max_chunk_size) {
+    const size_t chunks = (len + max_chunk_size - 1) / max_chunk_size;
+    if (frames_.size() < chunks) {
+        frames_.resize(chunks);
+    }
+    frame_sizes_.resize(chunks);
+
+    // Chunks are independent, each frame (including its checksum) is built by a worker
+    // into a buffer of its own, then all frames are written in order.
+    pool_->Run(chunks, [&] (size_t chunk, size_t thread) {
+        const size_t offset = chunk * max_chunk_size;
+        const size_t size = std::min(max_chunk_size, len - offset);
+
+        Buffer& frame = frames_[chunk];
+        const size_t bound = GetMaxFrameSize(size);
+        if (frame.size() < bound) {
+            frame.resize(bound);
+        }
+
+        frame_sizes_[chunk] = CompressFrame(static_cast<const char*>(data) + offset, size, frame, zstd_[thread]);
+    });
+
+    for (size_t i = 0; i < chunks; ++i) {
+        WireFormat::WriteBytes(*destination_, frames_[i].data(), frame_sizes_[i]);
+    }
+    destination_->Flush();
+}
+
+size_t CompressedOutput::CompressFrame(const void * data, size_t len, Buffer& frame, std::unique_ptr<ZSTDContext>& zstd) const {
+    char* const destination = (char*)frame.data() + HASH_SIZE + HEADER_SIZE;
+    const size_t capacity = frame.size() - HASH_SIZE - HEADER_SIZE;
+    size_t compressed_size = 0;
+    uint8_t method_byte = 0;
+
+    if (method_ == CompressionMethod::LZ4) {
+        const auto result = LZ4_compress_default(
+                (const char*)data,
+                destination,
+                len,
+                static_cast<int>(capacity));
+        if (result <= 0)
+            throw LZ4Error("Failed to compress chunk of " + std::to_string(len) + " bytes, "
+                    "LZ4 error: " + std::to_string(result));
+
+        compressed_size = result;
+        method_byte = CompressionMethodByte::LZ4;
+    } else {
+#if defined(WITH_ZSTD)
+        if (!zstd) {
+            zstd = std::make_unique<ZSTDContext>();
+        }
+        const size_t result = ZSTD_compressCCtx(zstd->cctx, destination, capacity, data, len,
+                level_ ? level_ : ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(result))
+            throw ZSTDError("Failed to compress chunk of " + std::to_string(len) + " bytes, "
+                    "ZSTD error: " + ZSTD_getErrorName(result));
+
+        compressed_size = result;
+        method_byte = CompressionMethodByte::ZSTD;
+#else
+        (void)zstd;
+#endif
+    }
 
     {
-        auto header = compressed_buffer_.data();
-        WriteUnaligned(header, COMPRESSION_METHOD);
+        auto header = frame.data() + HASH_SIZE;
+        WriteUnaligned(header, method_byte);
         // Compressed data size with header
         WriteUnaligned(header + 1, static_cast<uint32_t>(compressed_size + HEADER_SIZE));
         // Original data size
         WriteUnaligned(header + 5, static_cast<uint32_t>(len));
     }
 
-    WireFormat::WriteFixed(*destination_, CityHash128(
-        (const char*)compressed_buffer_.data(), compressed_size + HEADER_SIZE));
-    WireFormat::WriteBytes(*destination_, compressed_buffer_.data(), compressed_size + HEADER_SIZE);
+    // Checksum of the header and the compressed data precedes them.
+    WriteUnaligned(frame.data(), CityHash128(
+        (const char*)frame.data() + HASH_SIZE, compressed_size + HEADER_SIZE));
 
-    destination_->Flush();
+    return HASH_SIZE + HEADER_SIZE + compressed_size;
 }
 
-void CompressedOutput::PreallocateCompressBuffer(size_t input_size) {
+size_t CompressedOutput::GetMaxFrameSize(size_t input_size) const {
+#if defined(WITH_ZSTD)
+    if (method_ == CompressionMethod::ZSTD) {
+        return HASH_SIZE + HEADER_SIZE + ZSTD_compressBound(input_size);
+    }
+#endif
+
     const auto estimated_compressed_buffer_size = LZ4_compressBound(static_cast<int>(input_size));
     if (estimated_compressed_buffer_size <= 0)
         throw LZ4Error("Failed to estimate compressed buffer size, LZ4 error: " + std::to_string(estimated_compressed_buffer_size));
 
-    compressed_buffer_.resize(estimated_compressed_buffer_size + HEADER_SIZE + EXTRA_COMPRESS_BUFFER_SIZE);
+    return HASH_SIZE + HEADER_SIZE + estimated_compressed_buffer_size + EXTRA_COMPRESS_BUFFER_SIZE;
+}
+
+void CompressedOutput::PreallocateCompressBuffer(size_t input_size) {
+    compressed_buffer_.resize(GetMaxFrameSize(input_size));
 }
 
 }
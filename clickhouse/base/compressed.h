@@ -3,29 +3,94 @@
 #include "input.h"
 #include "output.h"
 #include "buffer.h"
+#include "../protocol.h"
+
+#include <memory>
+#include <vector>
 
 namespace clickhouse {
 
+class ThreadPool;
+
+/** Each frame of the stream could be compressed with a method of its own.
+ *
+ *  Buffers are reused from frame to frame. If the source is a ZeroCopyInput and a whole frame
+ *  is already in its buffer, the frame is checked and decompressed in place.
+ *
+ *  With read-ahead, frames following the current one in the buffer of a BufferedInput source
+ *  are checked and decompressed on a background thread while the current one is consumed.
+ *  The source must not be read by anyone else until StopReadAhead() is called.
+ */
 class CompressedInput : public ZeroCopyInput {
 public:
     CompressedInput(InputStream* input);
+    /// Decompresses up to \p read_ahead_frames frames in advance, 0 disables read-ahead.
+    CompressedInput(BufferedInput* input, size_t read_ahead_frames);
     ~CompressedInput();
 
+    /// Whether all decompressed data of the frames read so far is consumed.
+    inline bool Exhausted() const noexcept {
+        return mem_.Exhausted();
+    }
+
+    /// Waits for the background thread to stop accessing the buffer of the source.
+    /// Read-ahead is resumed by the next read of a frame.
+    void StopReadAhead();
+
 protected:
     size_t DoNext(const void** ptr, size_t len) override;
+    /// Returns the data left in the current frame, which may be less than \p len.
+    size_t DoPeek(const void** ptr, size_t len) override;
+    void DoConsume(size_t len) override;
 
     bool Decompress();
 
+private:
+    struct FrameHeader {
+        uint8_t method;
+        /// Size of the compressed data including the header.
+        uint32_t compressed;
+        uint32_t original;
+    };
+
+    struct ZSTDContext;
+    struct ReadAhead;
+
+    /// Reads the next frame from the source and decompresses it into data_.
+    bool DecompressNext();
+
+    static FrameHeader ParseHeader(const uint8_t* header);
+    /// Checks \p frame (the header followed by compressed data) against \p hash
+    /// and decompresses it into \p data.
+    static void DecompressFrame(const uint8_t* hash, const uint8_t* frame, const FrameHeader& header,
+                                Buffer& data, std::unique_ptr<ZSTDContext>& zstd);
+
 private:
     InputStream* const input_;
+    ZeroCopyInput* const zero_copy_input_;
+    BufferedInput* const buffered_input_;
 
+    /// Frame being decompressed, if it is not contiguous in the buffer of the input.
+    Buffer tmp_;
+    /// Decompressed data, could be larger than the current frame.
     Buffer data_;
     ArrayInput mem_;
+
+    std::unique_ptr<ZSTDContext> zstd_;
+    std::unique_ptr<ReadAhead> read_ahead_;
 };
 
+/** Splits the data into chunks of up to `max_compressed_chunk_size` bytes, each compressed into a frame.
+ *
+ *  If a \p pool is given, the chunks of a single large Write() are compressed in parallel on it,
+ *  frames are still written in order.
+ */
 class CompressedOutput : public OutputStream {
 public:
-    CompressedOutput(OutputStream * destination, size_t max_compressed_chunk_size = 0);
+    /// \p level is used by ZSTD only, 0 means the default level.
+    CompressedOutput(OutputStream * destination, size_t max_compressed_chunk_size = 0,
+                     CompressionMethod method = CompressionMethod::LZ4, int level = 0,
+                     ThreadPool* pool = nullptr);
     ~CompressedOutput();
 
 protected:
@@ -33,13 +98,28 @@ protected:
     void DoFlush() override;
 
 private:
-    void Compress(const void * data, size_t len);
+    struct ZSTDContext;
+
+    void CompressParallel(const void* data, size_t len, size_t max_chunk_size);
+    /// Writes checksum, header and compressed data into \p frame, returns the size of the frame.
+    size_t CompressFrame(const void * data, size_t len, Buffer& frame, std::unique_ptr<ZSTDContext>& zstd) const;
+    size_t GetMaxFrameSize(size_t input_size) const;
     void PreallocateCompressBuffer(size_t input_size);
 
 private:
     OutputStream * destination_;
     const size_t max_compressed_chunk_size_;
+    const CompressionMethod method_;
+    const int level_;
+    ThreadPool* const pool_;
     Buffer compressed_buffer_;
+
+    /// Frames compressed in parallel, and their sizes.
+    std::vector<Buffer> frames_;
+    std::vector<size_t> frame_sizes_;
+
+    /// One per thread of the pool.
+    std::vector<std::unique_ptr<ZSTDContext>> zstd_;
 };
 
 }
@@ -55,6 +55,17 @@ size_t ArrayInput::DoNext(const void** ptr, size_t len) {
     return len;
 }
 
+size_t ArrayInput::DoPeek(const void** ptr, size_t /*len*/) {
+    *ptr = data_;
+    return len_;
+}
+
+void ArrayInput::DoConsume(size_t len) {
+    len = std::min(len_, len);
+    len_  -= len;
+    data_ += len;
+}
+
 
 BufferedInput::BufferedInput(std::unique_ptr<InputStream> source, size_t buflen)
     : source_(std::move(source))
@@ -93,4 +104,34 @@ size_t BufferedInput::DoRead(void* buf, size_t len) {
     return array_input_.Read(buf, len);
 }
 
+size_t BufferedInput::DoPeek(const void** ptr, size_t len) {
+    const size_t avail = array_input_.Avail();
+
+    if (avail < len) {
+        if (avail) {
+            memmove(buffer_.data(), array_input_.Data(), avail);
+        }
+        if (buffer_.size() < len) {
+            buffer_.resize(len);
+        }
+
+        size_t filled = avail;
+        while (filled < len) {
+            const size_t result = source_->Read(buffer_.data() + filled, buffer_.size() - filled);
+            if (result == 0) {
+                break;
+            }
+            filled += result;
+        }
+
+        array_input_.Reset(buffer_.data(), filled);
+    }
+
+    return array_input_.Peek(ptr, len);
+}
+
+void BufferedInput::DoConsume(size_t len) {
+    array_input_.Consume(len);
+}
+
 }
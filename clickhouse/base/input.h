@@ -25,8 +25,28 @@ public:
     // Skips a number of bytes.  Returns false if an underlying read error occurs.
     virtual bool Skip(size_t bytes) = 0;
 
+    /// Returns contiguous data at the current position without consuming it, with at least \p len bytes
+    /// if the stream is able to provide them. May block until \p len bytes are received, so only
+    /// bytes which are going to be consumed should be requested. Returns 0 if peeking is not supported.
+    inline size_t Peek(const void** buf, size_t len) {
+        return DoPeek(buf, len);
+    }
+
+    /// Consumes \p len bytes of the data returned by Peek().
+    inline void Consume(size_t len) {
+        DoConsume(len);
+    }
+
 protected:
     virtual size_t DoRead(void* buf, size_t len) = 0;
+
+    virtual size_t DoPeek(const void** /*buf*/, size_t /*len*/) {
+        return 0;
+    }
+
+    virtual void DoConsume(size_t len) {
+        Skip(len);
+    }
 };
 
 
@@ -76,6 +96,8 @@ public:
 
 private:
     size_t DoNext(const void** ptr, size_t len) override;
+    size_t DoPeek(const void** ptr, size_t len) override;
+    void DoConsume(size_t len) override;
 
 private:
     const uint8_t* data_;
@@ -90,9 +112,21 @@ public:
 
     void Reset();
 
+    /// Data read from the source but not consumed yet, valid until the buffer is refilled.
+    inline const uint8_t* BufferedData() const noexcept {
+        return array_input_.Data();
+    }
+
+    inline size_t BufferedSize() const noexcept {
+        return array_input_.Avail();
+    }
+
 protected:
     size_t DoRead(void* buf, size_t len) override;
     size_t DoNext(const void** ptr, size_t len) override;
+    /// Moves the data left to the start of the buffer and reads more after it, if less than \p len bytes are left.
+    size_t DoPeek(const void** ptr, size_t len) override;
+    void DoConsume(size_t len) override;
 
 private:
     std::unique_ptr<InputStream> const source_;
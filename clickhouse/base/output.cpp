@@ -1,11 +1,37 @@
 #include "output.h"
+#include "../exceptions.h"
 
 #include <algorithm>
 #include <assert.h>
 #include <memory.h>
 
+namespace {
+/// Smaller data is copied into the buffer rather than referenced.
+constexpr size_t MIN_REFERENCED_SIZE = 4096;
+}
+
 namespace clickhouse {
 
+size_t OutputStream::DoWriteV(const OutputSegment* segments, size_t count) {
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* data = static_cast<const uint8_t*>(segments[i].data);
+        size_t len = segments[i].size;
+        while (len > 0) {
+            const size_t result = DoWrite(data, len);
+            if (!result) {
+                return written;
+            }
+            data += result;
+            len -= result;
+            written += result;
+        }
+    }
+
+    return written;
+}
+
+
 size_t ZeroCopyOutput::DoWrite(const void* data, size_t len) {
     const size_t original_len = len;
     while (len > 0) {
@@ -109,4 +135,78 @@ size_t BufferedOutput::DoWrite(const void* data, size_t len) {
     return array_output_.Write(data, len);
 }
 
+
+
+GatherOutput::GatherOutput(std::unique_ptr<OutputStream> destination, size_t buflen)
+    : destination_(std::move(destination))
+    , buffer_(buflen)
+    , array_output_(buffer_.data(), buflen)
+    , buffered_begin_(buffer_.data())
+{
+}
+
+GatherOutput::~GatherOutput() { }
+
+void GatherOutput::DoFlush() {
+    if (segments_.empty()) {
+        if (array_output_.Data() != buffer_.data()) {
+            destination_->Write(buffer_.data(), array_output_.Data() - buffer_.data());
+        }
+    } else {
+        AddBuffered();
+
+        size_t total = 0;
+        for (const auto& segment : segments_) {
+            total += segment.size;
+        }
+
+        const size_t written = destination_->WriteV(segments_.data(), segments_.size());
+        if (written != total) {
+            throw Error("Failed to write " + std::to_string(total)
+                    + " bytes, only written " + std::to_string(written));
+        }
+        segments_.clear();
+    }
+    destination_->Flush();
+
+    array_output_.Reset(buffer_.data(), buffer_.size());
+    buffered_begin_ = buffer_.data();
+}
+
+size_t GatherOutput::DoNext(void** data, size_t len) {
+    if (array_output_.Avail() < len) {
+        Flush();
+    }
+
+    return array_output_.Next(data, len);
+}
+
+size_t GatherOutput::DoWriteRef(const void* data, size_t len) {
+    if (len < MIN_REFERENCED_SIZE) {
+        return DoWrite(data, len);
+    }
+
+    AddBuffered();
+    segments_.push_back(OutputSegment{data, len});
+
+    return len;
+}
+
+void GatherOutput::AddBuffered() {
+    if (array_output_.Data() != buffered_begin_) {
+        segments_.push_back(OutputSegment{buffered_begin_, static_cast<size_t>(array_output_.Data() - buffered_begin_)});
+        buffered_begin_ = array_output_.Data();
+    }
+}
+
+
+CopyingOutput::CopyingOutput(OutputStream* destination)
+    : destination_(destination)
+{
+}
+
+size_t CopyingOutput::DoWrite(const void* data, size_t len) {
+    return destination_->Write(data, len);
+}
+
 }
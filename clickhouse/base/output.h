@@ -10,6 +10,12 @@
 
 namespace clickhouse {
 
+/// A piece of data written with OutputStream::WriteV().
+struct OutputSegment {
+    const void* data;
+    size_t size;
+};
+
 class OutputStream {
 public:
     virtual ~OutputStream()
@@ -23,10 +29,27 @@ public:
         return DoWrite(data, len);
     }
 
+    /// Writes data which stays valid and unchanged until the next Flush(),
+    /// so the stream may keep a reference to it instead of a copy.
+    inline size_t WriteRef(const void* data, size_t len) {
+        return DoWriteRef(data, len);
+    }
+
+    /// Writes all the segments in order, returns the total number of bytes written.
+    inline size_t WriteV(const OutputSegment* segments, size_t count) {
+        return DoWriteV(segments, count);
+    }
+
 protected:
     virtual void DoFlush() { }
 
     virtual size_t DoWrite(const void* data, size_t len) = 0;
+
+    virtual size_t DoWriteRef(const void* data, size_t len) {
+        return DoWrite(data, len);
+    }
+
+    virtual size_t DoWriteV(const OutputSegment* segments, size_t count);
 };
 
 
@@ -134,6 +157,53 @@ private:
     ArrayOutput array_output_;
 };
 
+/** GatherOutput collects the data to be written to the underlying stream until Flush().
+ *
+ *  Small writes are copied into the internal buffer, while data written with WriteRef()
+ *  is referenced, so that all of it goes to the underlying stream with a single WriteV().
+ *  Referenced data must stay valid and unchanged until Flush().
+ *
+ * Doesn't Flush() in destructor, client must ensure to do it manually at some point.
+ */
+class GatherOutput : public ZeroCopyOutput {
+public:
+    explicit GatherOutput(std::unique_ptr<OutputStream> destination, size_t buflen = 8192);
+    ~GatherOutput() override;
+
+protected:
+    void DoFlush() override;
+    size_t DoNext(void** data, size_t len) override;
+    size_t DoWriteRef(const void* data, size_t len) override;
+
+private:
+    /// Adds the data buffered since the last segment to the segments to be written.
+    void AddBuffered();
+
+private:
+    std::unique_ptr<OutputStream> const destination_;
+    Buffer buffer_;
+    ArrayOutput array_output_;
+    /// Start of the data buffered since the last segment.
+    const uint8_t* buffered_begin_;
+    std::vector<OutputSegment> segments_;
+};
+
+/** CopyingOutput passes the data to another stream, always as copies.
+ *
+ *  Used to write data which doesn't stay valid until the other stream is flushed,
+ *  like data of a temporary column. Flush() is not passed to the other stream.
+ */
+class CopyingOutput : public OutputStream {
+public:
+    explicit CopyingOutput(OutputStream* destination);
+
+protected:
+    size_t DoWrite(const void* data, size_t len) override;
+
+private:
+    OutputStream* const destination_;
+};
+
 template <typename T>
 void WriteUnaligned(void* buf, const T& value) {
     memcpy(buf, &value, sizeof(value));
@@ -2,6 +2,7 @@
 #include "singleton.h"
 #include "../client.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <stdexcept>
 #include <system_error>
@@ -15,6 +16,7 @@
 #   include <netdb.h>
 #   include <netinet/tcp.h>
 #   include <signal.h>
+#   include <sys/uio.h>
 #   include <unistd.h>
 #endif
 
@@ -371,6 +373,69 @@ size_t SocketOutput::DoWrite(const void* data, size_t len) {
     return len;
 }
 
+size_t SocketOutput::DoWriteV(const OutputSegment* segments, size_t count) {
+#if defined (_linux_)
+    static const int flags = MSG_NOSIGNAL;
+#else
+    static const int flags = 0;
+#endif
+    // Number of segments passed to a single call.
+    static const size_t max_batch = 64;
+
+    size_t written = 0;
+    while (count > 0) {
+        const size_t batch = std::min(count, max_batch);
+        size_t len = 0;
+#if defined(_win_)
+        WSABUF buffers[max_batch];
+        for (size_t i = 0; i < batch; ++i) {
+            buffers[i].buf = (char*)segments[i].data;
+            buffers[i].len = (ULONG)segments[i].size;
+            len += segments[i].size;
+        }
+
+        DWORD sent = 0;
+        if (::WSASend(s_, buffers, (DWORD)batch, &sent, 0, nullptr, nullptr) != 0 || sent != len) {
+            throw std::system_error(getSocketErrorCode(), getErrorCategory(), "fail to send " + std::to_string(len) + " bytes of data");
+        }
+#else
+        struct iovec buffers[max_batch];
+        for (size_t i = 0; i < batch; ++i) {
+            buffers[i].iov_base = const_cast<void*>(segments[i].data);
+            buffers[i].iov_len = segments[i].size;
+            len += segments[i].size;
+        }
+
+        struct msghdr message = {};
+        message.msg_iov = buffers;
+        message.msg_iovlen = batch;
+
+        const ssize_t sent = ::sendmsg(s_, &message, flags);
+        if (sent < 0) {
+            throw std::system_error(getSocketErrorCode(), getErrorCategory(), "fail to send " + std::to_string(len) + " bytes of data");
+        }
+        if ((size_t)sent != len) {
+            // Sends the rest of the batch segment by segment.
+            size_t skip = sent;
+            for (size_t i = 0; i < batch; ++i) {
+                if (skip >= segments[i].size) {
+                    skip -= segments[i].size;
+                    continue;
+                }
+                DoWrite(static_cast<const uint8_t*>(segments[i].data) + skip, segments[i].size - skip);
+                skip = 0;
+            }
+        }
+#endif
+
+        written += len;
+        segments += batch;
+        count -= batch;
+    }
+
+    return written;
+}
+
 
 NetrworkInitializer::NetrworkInitializer() {
     struct NetrworkInitializerImpl {
@@ -145,6 +145,7 @@ public:
 
 protected:
     size_t DoWrite(const void* data, size_t len) override;
+    size_t DoWriteV(const OutputSegment* segments, size_t count) override;
 
 private:
     SOCKET s_;
@@ -0,0 +1,97 @@
+#include "thread_pool.h"
+
+#include <utility>
+
+namespace clickhouse {
+
+ThreadPool::ThreadPool(size_t threads) {
+    for (size_t i = 1; i < threads; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+
+    for (auto & worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Run(size_t count, const Task& task) {
+    if (workers_.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        running_ = workers_.size() + 1;
+        error_ = nullptr;
+        ++generation_;
+    }
+    start_.notify_all();
+
+    RunTasks(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] () { return running_ == 0; });
+    task_ = nullptr;
+
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t thread) {
+    uint64_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [this, generation] () { return stop_ || generation_ != generation; });
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+        }
+
+        RunTasks(thread);
+    }
+}
+
+void ThreadPool::RunTasks(size_t thread) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (next_ < count_ && !error_) {
+        const size_t index = next_++;
+        lock.unlock();
+
+        try {
+            (*task_)(index, thread);
+        } catch (...) {
+            lock.lock();
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            continue;
+        }
+
+        lock.lock();
+    }
+
+    if (--running_ == 0) {
+        done_.notify_one();
+    }
+}
+
+}
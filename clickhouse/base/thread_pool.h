@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace clickhouse {
+
+/** Fixed set of threads to split a batch of independent tasks between.
+ *
+ *  One batch runs at a time, the calling thread takes part in it as well.
+ */
+class ThreadPool {
+public:
+    /// Task is called with the index of the task in the batch and the index of the thread
+    /// running it, from 0 (the calling thread) to GetThreadCount() - 1.
+    using Task = std::function<void(size_t task, size_t thread)>;
+
+    /// \p threads is the total number of threads running a batch, including the calling one.
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    /// Runs task for each index in [0, count) and waits for all of them to complete.
+    /// Rethrows the first exception thrown by a task, remaining tasks are skipped then.
+    void Run(size_t count, const Task& task);
+
+private:
+    void WorkerLoop(size_t thread);
+    void RunTasks(size_t thread);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+
+    /// Current batch.
+    const Task* task_ = nullptr;
+    size_t count_ = 0;
+    size_t next_ = 0;
+    size_t running_ = 0;
+    uint64_t generation_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+
+    std::vector<std::thread> workers_;
+};
+
+}
@@ -7,10 +7,6 @@
 
 #include <stdexcept>
 
-namespace {
-constexpr int MAX_VARINT_BYTES = 10;
-}
-
 namespace clickhouse {
 
 bool WireFormat::ReadAll(InputStream& input, void* buf, size_t len) {
@@ -45,7 +41,27 @@ void WireFormat::WriteAll(OutputStream& output, const void* buf, size_t len) {
     }
 }
 
+void WireFormat::WriteBytesRef(OutputStream& output, const void* buf, size_t len) {
+    const size_t written = output.WriteRef(buf, len);
+    if (written < len) {
+        WriteAll(output, static_cast<const uint8_t*>(buf) + written, len - written);
+    }
+}
+
 bool WireFormat::ReadVarint64(InputStream& input, uint64_t* value) {
+    // Requests a single byte, since the varint could be the last data received so far.
+    const void* ptr = nullptr;
+    const size_t size = input.Peek(&ptr, 1);
+    const size_t varint_size = DecodeVarint64(static_cast<const uint8_t*>(ptr), size, value);
+    if (varint_size) {
+        input.Consume(varint_size);
+        return true;
+    }
+    if (size >= MAX_VARINT_BYTES) {
+        return false;
+    }
+
+    // The varint crosses the end of the buffer, or the stream can't be peeked.
     *value = 0;
 
     for (size_t i = 0; i < MAX_VARINT_BYTES; ++i) {
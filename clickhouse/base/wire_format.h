@@ -1,14 +1,20 @@
 #pragma once
 
+#include "input.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 namespace clickhouse {
 
-class InputStream;
 class OutputStream;
 
 class WireFormat {
 public:
+    static constexpr size_t MAX_VARINT_BYTES = 10;
+
     template <typename T>
     static bool ReadFixed(InputStream& input, T* value);
     static bool ReadString(InputStream& input, std::string* value);
@@ -16,10 +22,15 @@ public:
     static bool ReadBytes(InputStream& input, void* buf, size_t len);
     static bool ReadUInt64(InputStream& input, uint64_t* value);
     static bool ReadVarint64(InputStream& output, uint64_t* value);
+    /// Decodes a varint at the start of \p data, returns the number of bytes it takes
+    /// or 0 if \p data does not start with a complete valid varint.
+    static size_t DecodeVarint64(const uint8_t* data, size_t size, uint64_t* value);
 
     template <typename T>
     static void WriteFixed(OutputStream& output, const T& value);
     static void WriteBytes(OutputStream& output, const void* buf, size_t len);
+    /// Same as WriteBytes(), for data which stays valid and unchanged until output is flushed.
+    static void WriteBytesRef(OutputStream& output, const void* buf, size_t len);
     static void WriteString(OutputStream& output, std::string_view value);
     static void WriteUInt64(OutputStream& output, const uint64_t value);
     static void WriteVarint64(OutputStream& output, uint64_t value);
@@ -31,6 +42,13 @@ private:
 
 template <typename T>
 inline bool WireFormat::ReadFixed(InputStream& input, T* value) {
+    const void* ptr = nullptr;
+    if (input.Peek(&ptr, sizeof(T)) >= sizeof(T)) {
+        memcpy(value, ptr, sizeof(T));
+        input.Consume(sizeof(T));
+        return true;
+    }
+
     return ReadAll(input, value, sizeof(T));
 }
 
@@ -55,6 +73,26 @@ inline bool WireFormat::ReadUInt64(InputStream& input, uint64_t* value) {
     return ReadVarint64(input, value);
 }
 
+inline size_t WireFormat::DecodeVarint64(const uint8_t* data, size_t size, uint64_t* value) {
+    // Most lengths of strings fit into a single byte.
+    if (size && data[0] < 0x80) {
+        *value = data[0];
+        return 1;
+    }
+
+    uint64_t result = 0;
+    const size_t limit = std::min(size, MAX_VARINT_BYTES);
+    for (size_t i = 0; i < limit; ++i) {
+        result |= uint64_t(data[i] & 0x7F) << (7 * i);
+        if (!(data[i] & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
 template <typename T>
 inline void WireFormat::WriteFixed(OutputStream& output, const T& value) {
     WriteAll(output, &value, sizeof(T));
@@ -0,0 +1,424 @@
+#include "batching_inserter.h"
+
+#include "base/output.h"
+#include "columns/factory.h"
+#include "columns/lowcardinality.h"
+#include "columns/nullable.h"
+#include "columns/string.h"
+#include "columns/tuple.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace clickhouse {
+
+namespace {
+
+/// Discards the data, only counts the bytes written.
+class CountingOutput : public OutputStream {
+public:
+    inline size_t Size() const noexcept {
+        return size_;
+    }
+
+protected:
+    size_t DoWrite(const void* data, size_t len) override {
+        (void)data;
+        size_ += len;
+        return len;
+    }
+
+private:
+    size_t size_ = 0;
+};
+
+size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    for (; value >= 0x80; value >>= 7) {
+        ++size;
+    }
+    return size;
+}
+
+size_t StringSize(size_t len) {
+    return VarintSize(len) + len;
+}
+
+/// Size of a value of the type on the wire, 0 if values of the type are of different sizes.
+size_t FixedValueSize(Type::Code code) {
+    switch (code) {
+        case Type::Int8:
+        case Type::UInt8:
+        case Type::Enum8:
+            return 1;
+        case Type::Int16:
+        case Type::UInt16:
+        case Type::Date:
+        case Type::Enum16:
+            return 2;
+        case Type::Int32:
+        case Type::UInt32:
+        case Type::Float32:
+        case Type::DateTime:
+        case Type::IPv4:
+        case Type::Decimal32:
+            return 4;
+        case Type::Int64:
+        case Type::UInt64:
+        case Type::Float64:
+        case Type::DateTime64:
+        case Type::Decimal64:
+            return 8;
+        case Type::Int128:
+        case Type::UUID:
+        case Type::IPv6:
+        case Type::Decimal128:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+/// Size of the column data when sent to the server, computed without serializing the column where possible.
+size_t EstimateSize(const ColumnRef& column) {
+    const size_t rows = column->Size();
+
+    if (const size_t value_size = FixedValueSize(column->GetType().GetCode())) {
+        return rows * value_size;
+    }
+    if (auto strings = column->As<ColumnString>()) {
+        size_t size = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            size += StringSize((*strings)[i].size());
+        }
+        return size;
+    }
+    if (auto strings = column->As<ColumnFixedString>()) {
+        return rows * strings->FixedSize();
+    }
+    if (auto nullable = column->As<ColumnNullable>()) {
+        return rows + EstimateSize(nullable->Nested());
+    }
+    if (auto tuple = column->As<ColumnTuple>()) {
+        size_t size = 0;
+        for (size_t i = 0; i < tuple->TupleSize(); ++i) {
+            size += EstimateSize((*tuple)[i]);
+        }
+        return size;
+    }
+    if (auto low_cardinality = column->As<ColumnLowCardinality>()) {
+        // Each distinct value is sent once, rows refer to them with the narrowest index which fits.
+        const size_t keys = low_cardinality->GetDictionarySize();
+        const size_t index_size = keys <= 0x100 ? 1 : keys <= 0x10000 ? 2 : keys <= 0x100000000ull ? 4 : 8;
+        size_t values_size = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            values_size += low_cardinality->GetItem(i).data.size();
+        }
+        return rows * index_size + (rows ? values_size * keys / rows : 0);
+    }
+
+    // Arrays don't tell sizes of their items without making a column of each, so those are serialized.
+    CountingOutput output;
+    column->Save(&output);
+    return output.Size();
+}
+
+/// Size of the block when sent to the server, without compression.
+size_t EstimateSize(const Block& block) {
+    size_t size = 0;
+
+    for (Block::Iterator bi(block); bi.IsValid(); bi.Next()) {
+        size += StringSize(bi.Name().size());
+        size += StringSize(bi.Type()->GetName().size());
+        size += EstimateSize(bi.Column());
+    }
+
+    return size;
+}
+
+bool HasSameStructure(const Block& left, const Block& right) {
+    if (left.GetColumnCount() != right.GetColumnCount()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < left.GetColumnCount(); ++i) {
+        if (left.GetColumnName(i) != right.GetColumnName(i) || !left[i]->Type()->IsEqual(right[i]->Type())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::chrono::microseconds ElapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+}
+
+BatchingInserter::BatchingInserter(const BatchingInserterOptions& options)
+    : options_(options)
+    , client_(std::make_unique<Client>(options_.client_options))
+{
+    if (options_.max_block_rows == 0) {
+        throw ValidationError("max_block_rows of the BatchingInserter must be greater than 0");
+    }
+
+    thread_ = std::thread(&BatchingInserter::Run, this);
+}
+
+BatchingInserter::~BatchingInserter() {
+    try {
+        Close();
+    } catch (...) {
+    }
+}
+
+void BatchingInserter::Add(const std::string& table_name, const Block& block) {
+    const size_t rows = block.GetRowCount();
+    const size_t bytes = rows ? EstimateSize(block) : 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+        throw ValidationError("BatchingInserter is closed");
+    }
+    if (rows == 0) {
+        return;
+    }
+
+    // A single block larger than max_pending_bytes is still accepted once everything else is inserted.
+    const auto has_room = [this, bytes] () {
+        return closed_ || stats_.pending_bytes == 0 || stats_.pending_bytes + bytes <= options_.max_pending_bytes;
+    };
+    if (!has_room()) {
+        const auto wait_started_at = std::chrono::steady_clock::now();
+        ++stats_.backpressure_waits;
+        progress_.wait(lock, has_room);
+        stats_.backpressure_time += ElapsedSince(wait_started_at);
+
+        if (closed_) {
+            throw ValidationError("BatchingInserter is closed");
+        }
+    }
+
+    queue_.push_back(PendingBlock{table_name, block, bytes});
+
+    ++stats_.blocks_added;
+    stats_.rows_added += rows;
+    stats_.bytes_added += bytes;
+    stats_.pending_rows += rows;
+    stats_.pending_bytes += bytes;
+
+    lock.unlock();
+    wakeup_.notify_one();
+}
+
+void BatchingInserter::Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!stopped_) {
+        const uint64_t request = ++flush_requested_;
+        wakeup_.notify_one();
+        progress_.wait(lock, [this, request] () { return stopped_ || flush_completed_ >= request; });
+    }
+
+    ThrowIfFailed();
+}
+
+void BatchingInserter::Close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (closed_) {
+        // Someone else is stopping the background thread.
+        progress_.wait(lock, [this] () { return stopped_; });
+    } else {
+        closed_ = true;
+        lock.unlock();
+        wakeup_.notify_one();
+        // Wake up Add() calls blocked by backpressure.
+        progress_.notify_all();
+
+        thread_.join();
+
+        lock.lock();
+        stopped_ = true;
+        progress_.notify_all();
+    }
+
+    ThrowIfFailed();
+}
+
+BatchingInserterStats BatchingInserter::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+const BatchingInserterOptions& BatchingInserter::GetOptions() const {
+    return options_;
+}
+
+void BatchingInserter::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        const auto has_work = [this] () {
+            return !queue_.empty() || flush_requested_ != flush_completed_ || closed_;
+        };
+
+        if (batches_.empty()) {
+            wakeup_.wait(lock, has_work);
+        } else {
+            auto deadline = std::chrono::steady_clock::time_point::max();
+            for (const auto & batch : batches_) {
+                deadline = std::min(deadline, batch.second.deadline);
+            }
+            wakeup_.wait_until(lock, deadline, has_work);
+        }
+
+        std::vector<PendingBlock> pending;
+        pending.swap(queue_);
+        const uint64_t flush_requested = flush_requested_;
+        const bool flush_all = closed_ || flush_requested_ != flush_completed_;
+        const bool closed = closed_;
+        lock.unlock();
+
+        // Blocks are coalesced and inserted with the lock released, so Add() is never blocked by the server.
+        for (auto & block : pending) {
+            AppendToBatch(std::move(block));
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = batches_.begin(); it != batches_.end(); ) {
+            if (flush_all) {
+                InsertBatch(it->first, it->second, FlushReason::Requested);
+            } else if (it->second.deadline <= now) {
+                InsertBatch(it->first, it->second, FlushReason::Deadline);
+            }
+
+            if (it->second.rows == 0) {
+                it = batches_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        lock.lock();
+        flush_completed_ = flush_requested;
+        progress_.notify_all();
+
+        if (closed && queue_.empty()) {
+            break;
+        }
+    }
+}
+
+void BatchingInserter::AppendToBatch(PendingBlock&& pending) {
+    const Block& block = pending.block;
+    const size_t rows = block.GetRowCount();
+    Batch& batch = batches_[pending.table_name];
+
+    try {
+        if (batch.rows > 0 && (!HasSameStructure(batch.block, block)
+                || batch.rows + rows > options_.max_block_rows
+                || batch.bytes + pending.bytes > options_.max_block_bytes)) {
+            InsertBatch(pending.table_name, batch, FlushReason::Size);
+        }
+
+        if (batch.rows == 0) {
+            batch.block = Block();
+            for (Block::Iterator bi(block); bi.IsValid(); bi.Next()) {
+                ColumnRef column = CreateColumnByType(bi.Type()->GetName());
+                if (!column) {
+                    throw UnimplementedError("unsupported column type: " + bi.Type()->GetName());
+                }
+                batch.block.AppendColumn(bi.Name(), column);
+            }
+            batch.deadline = std::chrono::steady_clock::now() + options_.flush_interval;
+        }
+
+        for (size_t i = 0; i < block.GetColumnCount(); ++i) {
+            batch.block[i]->Append(block[i]);
+        }
+        batch.block.RefreshRowCount();
+    } catch (...) {
+        // The batch may be left partially appended, so it is dropped along with the block.
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.batches_failed;
+        stats_.rows_failed += batch.rows + rows;
+        stats_.pending_rows -= batch.rows + rows;
+        stats_.pending_bytes -= batch.bytes + pending.bytes;
+        error_ = std::current_exception();
+        progress_.notify_all();
+
+        batch = Batch();
+        return;
+    }
+
+    batch.rows += rows;
+    batch.bytes += pending.bytes;
+
+    if (batch.rows >= options_.max_block_rows || batch.bytes >= options_.max_block_bytes) {
+        InsertBatch(pending.table_name, batch, FlushReason::Size);
+    }
+}
+
+void BatchingInserter::InsertBatch(const std::string& table_name, Batch& batch, FlushReason reason) {
+    if (batch.rows == 0) {
+        return;
+    }
+
+    const auto started_at = std::chrono::steady_clock::now();
+    std::exception_ptr error;
+    try {
+        client_->Insert(table_name, batch.block);
+    } catch (...) {
+        error = std::current_exception();
+        // The connection may be left in the middle of the query.
+        try {
+            client_->ResetConnection();
+        } catch (...) {
+        }
+    }
+    const auto flush_time = ElapsedSince(started_at);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.pending_rows -= batch.rows;
+    stats_.pending_bytes -= batch.bytes;
+
+    if (error) {
+        ++stats_.batches_failed;
+        stats_.rows_failed += batch.rows;
+        error_ = error;
+    } else {
+        ++stats_.batches_inserted;
+        stats_.rows_inserted += batch.rows;
+        stats_.bytes_inserted += batch.bytes;
+        stats_.max_batch_rows = std::max<uint64_t>(stats_.max_batch_rows, batch.rows);
+    }
+
+    switch (reason) {
+        case FlushReason::Size:
+            ++stats_.flushes_by_size;
+            break;
+        case FlushReason::Deadline:
+            ++stats_.flushes_by_deadline;
+            break;
+        case FlushReason::Requested:
+            ++stats_.flushes_requested;
+            break;
+    }
+    stats_.flush_time += flush_time;
+    stats_.max_flush_time = std::max(stats_.max_flush_time, flush_time);
+
+    progress_.notify_all();
+
+    batch = Batch();
+}
+
+void BatchingInserter::ThrowIfFailed() {
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+}
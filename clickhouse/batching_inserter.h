@@ -0,0 +1,169 @@
+#pragma once
+
+#include "client.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace clickhouse {
+
+struct BatchingInserterOptions {
+#define DECLARE_FIELD(name, type, setter, default_value) \
+    type name = default_value; \
+    inline auto & setter(const type& value) { \
+        name = value; \
+        return *this; \
+    }
+
+    /// Options used to establish the connection the batches are inserted with.
+    DECLARE_FIELD(client_options, ClientOptions, SetClientOptions, ClientOptions());
+
+    /// A batch is inserted once it has that many rows.
+    DECLARE_FIELD(max_block_rows, size_t, SetMaxBlockRows, 65536);
+
+    /// A batch is inserted once it takes about that many bytes on the wire (before compression),
+    /// sizes are estimated from the column data without serializing it.
+    DECLARE_FIELD(max_block_bytes, size_t, SetMaxBlockBytes, 16 * 1024 * 1024);
+
+    /// Max time the rows are kept in a batch before being inserted.
+    DECLARE_FIELD(flush_interval, std::chrono::milliseconds, SetFlushInterval, std::chrono::seconds(1));
+
+    /// Max size of the data added but not yet inserted, Add() blocks until there is room for more.
+    DECLARE_FIELD(max_pending_bytes, size_t, SetMaxPendingBytes, 64 * 1024 * 1024);
+
+#undef DECLARE_FIELD
+};
+
+struct BatchingInserterStats {
+    /// Number of blocks passed to Add() and their total size.
+    uint64_t blocks_added = 0;
+    uint64_t rows_added = 0;
+    uint64_t bytes_added = 0;
+
+    /// Data added but not yet inserted.
+    uint64_t pending_rows = 0;
+    uint64_t pending_bytes = 0;
+
+    /// Number of successfully inserted batches and their total size.
+    uint64_t batches_inserted = 0;
+    uint64_t rows_inserted = 0;
+    uint64_t bytes_inserted = 0;
+    /// Number of rows in the largest inserted batch.
+    uint64_t max_batch_rows = 0;
+
+    /// Number of batches (and their rows) lost because the insert failed.
+    uint64_t batches_failed = 0;
+    uint64_t rows_failed = 0;
+
+    /// What triggered insertion of the batches.
+    uint64_t flushes_by_size = 0;
+    uint64_t flushes_by_deadline = 0;
+    uint64_t flushes_requested = 0;
+
+    /// Total and max time spent inserting a single batch.
+    std::chrono::microseconds flush_time{0};
+    std::chrono::microseconds max_flush_time{0};
+
+    /// Number of Add() calls blocked due to max_pending_bytes, and total time spent waiting.
+    uint64_t backpressure_waits = 0;
+    std::chrono::microseconds backpressure_time{0};
+};
+
+/** Coalesces small blocks added from any number of threads into larger ones,
+ *  which are inserted by a background thread over a connection of its own.
+ *
+ *  Blocks added for the same table are appended to a single batch, which is inserted
+ *  once it reaches `max_block_rows` or `max_block_bytes`, or when it is `flush_interval` old.
+ *  All blocks of a table are expected to have the same columns, a block of a different
+ *  structure causes the current batch of the table to be inserted first.
+ *
+ *  There is no entry point for single rows, since the library has no row type:
+ *  rows are added as blocks, a block of a single row is fine.
+ *
+ *  Batches which failed to be inserted are dropped, the error is rethrown by the next
+ *  call to Flush() or Close().
+ */
+class BatchingInserter {
+public:
+    explicit BatchingInserter(const BatchingInserterOptions& options);
+    /// Inserts all pending data, errors are ignored, call Close() to handle them.
+    ~BatchingInserter();
+
+    BatchingInserter(const BatchingInserter&) = delete;
+    BatchingInserter& operator=(const BatchingInserter&) = delete;
+
+    /// Queues rows of the block to be inserted into \p table_name.
+    /// Blocks while there is more than `max_pending_bytes` of data waiting to be inserted.
+    /// The block must not be modified afterwards, since its columns are not copied until
+    /// processed by the background thread.
+    void Add(const std::string& table_name, const Block& block);
+
+    /// Inserts all data added so far, waits for completion.
+    void Flush();
+
+    /// Inserts all data added so far and stops the background thread.
+    /// No data could be added afterwards.
+    void Close();
+
+    BatchingInserterStats GetStats() const;
+
+    const BatchingInserterOptions& GetOptions() const;
+
+private:
+    struct PendingBlock {
+        std::string table_name;
+        Block block;
+        size_t bytes;
+    };
+
+    struct Batch {
+        Block block;
+        size_t rows = 0;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    enum class FlushReason {
+        Size,
+        Deadline,
+        Requested,
+    };
+
+    void Run();
+    void AppendToBatch(PendingBlock&& pending);
+    void InsertBatch(const std::string& table_name, Batch& batch, FlushReason reason);
+    void ThrowIfFailed();
+
+private:
+    const BatchingInserterOptions options_;
+
+    /// Used by the background thread only.
+    std::unique_ptr<Client> client_;
+    std::unordered_map<std::string, Batch> batches_;
+
+    mutable std::mutex mutex_;
+    /// Signals the background thread about new blocks, flush or close requests.
+    std::condition_variable wakeup_;
+    /// Signals Add() and Flush() about inserted batches.
+    std::condition_variable progress_;
+
+    std::vector<PendingBlock> queue_;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_completed_ = 0;
+    bool closed_ = false;
+    bool stopped_ = false;
+    std::exception_ptr error_;
+    BatchingInserterStats stats_;
+
+    std::thread thread_;
+};
+
+}
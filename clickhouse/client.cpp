@@ -2,16 +2,24 @@
 #include "protocol.h"
 
 #include "base/compressed.h"
+#include "base/output.h"
 #include "base/socket.h"
+#include "base/thread_pool.h"
 #include "base/wire_format.h"
 
 #include "columns/factory.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <system_error>
 #include <thread>
 #include <vector>
+#include <utility>
 #include <sstream>
 #include <stdexcept>
 
@@ -34,8 +42,11 @@
 #define DBMS_MIN_REVISION_WITH_SERVER_DISPLAY_NAME      54372
 #define DBMS_MIN_REVISION_WITH_VERSION_PATCH            54401
 #define DBMS_MIN_REVISION_WITH_LOW_CARDINALITY_TYPE     54405
+#define DBMS_MIN_REVISION_WITH_COLUMN_DEFAULTS_METADATA 54410
+#define DBMS_MIN_REVISION_WITH_CLIENT_WRITE_INFO        54420
+#define DBMS_MIN_REVISION_WITH_SETTINGS_SERIALIZED_AS_STRINGS 54429
 
-#define REVISION  DBMS_MIN_REVISION_WITH_LOW_CARDINALITY_TYPE
+#define REVISION  DBMS_MIN_REVISION_WITH_SETTINGS_SERIALIZED_AS_STRINGS
 
 namespace clickhouse {
 
@@ -61,7 +72,11 @@ std::ostream& operator<<(std::ostream& os, const ClientOptions& opt) {
        << " send_retries:" << opt.send_retries
        << " retry_timeout:" << opt.retry_timeout.count()
        << " compression_method:"
-       << (opt.compression_method == CompressionMethod::LZ4 ? "LZ4" : "None");
+       << (opt.compression_method == CompressionMethod::LZ4 ? "LZ4"
+           : opt.compression_method == CompressionMethod::ZSTD ? "ZSTD" : "None");
+    if (opt.compression_method == CompressionMethod::ZSTD) {
+        os << " compression_level:" << opt.compression_level;
+    }
 #if defined(WITH_OPENSSL)
     if (opt.ssl_options) {
         const auto & ssl_options = *opt.ssl_options;
@@ -93,6 +108,9 @@ ClientOptions& ClientOptions::SetSSLOptions(ClientOptions::SSLOptions options)
 
 namespace {
 
+/// The server compresses data in frames of up to 1MB, usually much less once compressed.
+constexpr size_t READ_AHEAD_BUFFER_PER_FRAME = 1024 * 1024;
+
 std::unique_ptr<SocketFactory> GetSocketFactory(const ClientOptions& opts) {
     (void)opts;
 #if defined(WITH_OPENSSL)
@@ -103,6 +121,27 @@ std::unique_ptr<SocketFactory> GetSocketFactory(const ClientOptions& opts) {
         return std::make_unique<NonSecureSocketFactory>();
 }
 
+/// Returns name and type of a block column as they are encoded on the wire.
+Buffer EncodeColumnHeader(const std::string& name, const std::string& type) {
+    Buffer header;
+    BufferOutput output(&header);
+    WireFormat::WriteString(output, name);
+    WireFormat::WriteString(output, type);
+    output.Flush();
+    return header;
+}
+
+/// Consumes \p bytes if the input continues with them. Only data the input already has is compared,
+/// so false may be returned for matching bytes, e.g. if they cross a buffer boundary.
+bool SkipIfNext(InputStream& input, const Buffer& bytes) {
+    const void* data = nullptr;
+    if (input.Peek(&data, 1) < bytes.size() || std::memcmp(data, bytes.data(), bytes.size()) != 0) {
+        return false;
+    }
+    input.Consume(bytes.size());
+    return true;
+}
+
 }
 
 class Client::Impl {
@@ -112,12 +151,25 @@ public:
           std::unique_ptr<SocketFactory> socket_factory);
     ~Impl();
 
-    void ExecuteQuery(Query query);
+    /// Result columns are not reused if \p keep_blocks is set, since the blocks are kept after OnData() returns.
+    /// \p cancel_requested is checked after every received packet, the query is cancelled once it returns true.
+    void ExecuteQuery(Query query, bool keep_blocks = false, std::function<bool()> cancel_requested = {});
 
     void SendCancel();
 
     void Insert(const std::string& table_name, const std::string& query_id, const Block& block);
 
+    /// Sends an INSERT query and returns the header block received from the server.
+    Block BeginInsert(Query query);
+
+    void SendInsertData(const Block& block);
+
+    /// Sends end of data marker and waits for the end of the INSERT query.
+    void EndInsert();
+
+    /// Abandons the INSERT in progress after a failure, so the client can be used for other queries.
+    void AbortInsert() noexcept;
+
     void Ping();
 
     void ResetConnection();
@@ -129,13 +181,26 @@ private:
 
     bool ReceivePacket(uint64_t* server_packet = nullptr);
 
-    void SendQuery(const std::string& query, const std::string& query_id);
+    void SendQuery(const Query& query, bool keep_blocks = false);
 
     void SendData(const Block& block);
 
     bool SendHello();
 
-    bool ReadBlock(InputStream& input, Block* block);
+    /// Column of the current query result, remembered from the first block which has it.
+    struct ResultColumn {
+        std::string name;
+        std::string type;
+        /// Name and type as encoded on the wire, compared with headers of the following blocks.
+        Buffer header;
+        /// Column loaded again for each block if the result columns are reused,
+        /// otherwise an empty column which is cloned for each block.
+        ColumnRef column;
+    };
+
+    /// Reads a block. Columns matching \p result_columns by position, name and type are made from them
+    /// without resolving the type, other columns are added to \p result_columns.
+    bool ReadBlock(InputStream& input, Block* block, std::vector<ResultColumn>* result_columns = nullptr);
 
     bool ReceiveHello();
 
@@ -149,6 +214,9 @@ private:
 
     void InitializeStreams(std::unique_ptr<SocketBase>&& socket);
 
+    /// Throws if an INSERT started with BeginInsert() is still in progress.
+    void CheckNoInsertInProgress() const;
+
 private:
     /// In case of network errors tries to reconnect to server and
     /// call fuc several times.
@@ -184,10 +252,22 @@ private:
     std::unique_ptr<SocketFactory> socket_factory_;
 
     std::unique_ptr<InputStream> input_;
+    std::unique_ptr<CompressedInput> compressed_input_;
     std::unique_ptr<OutputStream> output_;
     std::unique_ptr<SocketBase> socket_;
 
+    /// Compresses chunks of outgoing blocks in parallel, if enabled.
+    std::unique_ptr<ThreadPool> compression_pool_;
+
     ServerInfo server_info_;
+
+    /// Set between BeginInsert() and EndInsert().
+    bool insert_in_progress_ = false;
+
+    /// Columns of the current query result.
+    std::vector<ResultColumn> result_columns_;
+    /// Whether the result columns of the current query are loaded again for each block.
+    bool reuse_result_columns_ = false;
 };
 
 
@@ -200,6 +280,12 @@ Client::Impl::Impl(const ClientOptions& opts,
     , events_(nullptr)
     , socket_factory_(std::move(socket_factory))
 {
+#if !defined(WITH_ZSTD)
+    if (options_.compression_method == CompressionMethod::ZSTD) {
+        throw ValidationError("Library was built with no ZSTD support");
+    }
+#endif
+
     for (unsigned int i = 0; ; ) {
         try {
             ResetConnection();
@@ -215,23 +301,32 @@ Client::Impl::Impl(const ClientOptions& opts,
 
     if (options_.compression_method != CompressionMethod::None) {
         compression_ = CompressionState::Enable;
+
+        if (options_.compression_threads > 1) {
+            compression_pool_ = std::make_unique<ThreadPool>(options_.compression_threads);
+        }
     }
 }
 
 Client::Impl::~Impl()
 { }
 
-void Client::Impl::ExecuteQuery(Query query) {
+void Client::Impl::ExecuteQuery(Query query, bool keep_blocks, std::function<bool()> cancel_requested) {
+    CheckNoInsertInProgress();
+
     EnsureNull en(static_cast<QueryEvents*>(&query), &events_);
 
     if (options_.ping_before_query) {
         RetryGuard([this]() { Ping(); });
     }
 
-    SendQuery(query.GetText(), query.GetQueryID());
+    SendQuery(query, keep_blocks);
 
     while (ReceivePacket()) {
-        ;
+        // Progress packets are sent periodically, so the request is seen even if the query produces no rows.
+        if (cancel_requested && cancel_requested()) {
+            SendCancel();
+        }
     }
 }
 
@@ -255,10 +350,6 @@ std::string NameToQueryString(const std::string &input)
 }
 
 void Client::Impl::Insert(const std::string& table_name, const std::string& query_id, const Block& block) {
-    if (options_.ping_before_query) {
-        RetryGuard([this]() { Ping(); });
-    }
-
     std::stringstream fields_section;
         const auto num_columns = block.GetColumnCount();
 
@@ -270,7 +361,29 @@ void Client::Impl::Insert(const std::string& table_name, const std::string& quer
         }
     }
 
-    SendQuery("INSERT INTO " + table_name + " ( " + fields_section.str() + " ) VALUES", query_id);
+    BeginInsert(Query("INSERT INTO " + table_name + " ( " + fields_section.str() + " ) VALUES", query_id));
+    try {
+        SendInsertData(block);
+        EndInsert();
+    } catch (...) {
+        AbortInsert();
+        throw;
+    }
+}
+
+Block Client::Impl::BeginInsert(Query query) {
+    CheckNoInsertInProgress();
+
+    if (options_.ping_before_query) {
+        RetryGuard([this]() { Ping(); });
+    }
+
+    // Server replies to INSERT with an empty block describing the structure of the table.
+    Block header;
+    query.OnData([&header](const Block& block) { header = block; });
+    EnsureNull en(static_cast<QueryEvents*>(&query), &events_);
+
+    SendQuery(query);
 
     uint64_t server_packet;
     // Receive data packet.
@@ -288,8 +401,27 @@ void Client::Impl::Insert(const std::string& table_name, const std::string& quer
         }
     }
 
-    // Send data.
-    SendData(block);
+    insert_in_progress_ = true;
+    return header;
+}
+
+void Client::Impl::SendInsertData(const Block& block) {
+    if (!insert_in_progress_) {
+        throw ValidationError("no INSERT query in progress");
+    }
+
+    // Empty block is a marker of end of data.
+    if (block.GetRowCount() > 0) {
+        SendData(block);
+    }
+}
+
+void Client::Impl::EndInsert() {
+    if (!insert_in_progress_) {
+        throw ValidationError("no INSERT query in progress");
+    }
+    insert_in_progress_ = false;
+
     // Send empty block as marker of
     // end of data.
     SendData(Block());
@@ -307,7 +439,21 @@ void Client::Impl::Insert(const std::string& table_name, const std::string& quer
     }
 }
 
+void Client::Impl::AbortInsert() noexcept {
+    insert_in_progress_ = false;
+
+    // The only way to abort an INSERT is to drop the connection,
+    // which is also the only safe thing to do once sending or receiving data failed.
+    try {
+        ResetConnection();
+    } catch (...) {
+        // The next query fails on the broken connection and tries to reconnect, if enabled.
+    }
+}
+
 void Client::Impl::Ping() {
+    CheckNoInsertInProgress();
+
     WireFormat::WriteUInt64(*output_, ClientCodes::Ping);
     output_->Flush();
 
@@ -320,6 +466,7 @@ void Client::Impl::Ping() {
 }
 
 void Client::Impl::ResetConnection() {
+    insert_in_progress_ = false;
     InitializeStreams(socket_factory_->connect(options_));
 
     if (!Handshake()) {
@@ -407,6 +554,14 @@ bool Client::Impl::ReceivePacket(uint64_t* server_packet) {
                 return false;
             }
         }
+        if (server_info_.revision >= DBMS_MIN_REVISION_WITH_CLIENT_WRITE_INFO) {
+            if (!WireFormat::ReadUInt64(*input_, &info.written_rows)) {
+                return false;
+            }
+            if (!WireFormat::ReadUInt64(*input_, &info.written_bytes)) {
+                return false;
+            }
+        }
 
         if (events_) {
             events_->OnProgress(info);
@@ -426,6 +581,37 @@ bool Client::Impl::ReceivePacket(uint64_t* server_packet) {
         return false;
     }
 
+    case ServerCodes::Log: {
+        // Log tag.
+        if (!WireFormat::SkipString(*input_)) {
+            return false;
+        }
+        Block block;
+
+        // Log blocks are always sent uncompressed.
+        if (!ReadBlock(*input_, &block)) {
+            return false;
+        }
+
+        if (events_) {
+            events_->OnServerLog(block);
+        }
+        return true;
+    }
+
+    case ServerCodes::TableColumns: {
+        // External table name.
+        if (!WireFormat::SkipString(*input_)) {
+            return false;
+        }
+
+        // Columns metadata, used by the server to calculate default values, which are not supported.
+        if (!WireFormat::SkipString(*input_)) {
+            return false;
+        }
+        return true;
+    }
+
     default:
         throw UnimplementedError("unimplemented " + std::to_string((int)packet_type));
         break;
@@ -434,7 +620,7 @@ bool Client::Impl::ReceivePacket(uint64_t* server_packet) {
     return false;
 }
 
-bool Client::Impl::ReadBlock(InputStream& input, Block* block) {
+bool Client::Impl::ReadBlock(InputStream& input, Block* block, std::vector<ResultColumn>* result_columns) {
     // Additional information about block.
     if (REVISION >= DBMS_MIN_REVISION_WITH_BLOCK_INFO) {
         uint64_t num;
@@ -476,22 +662,53 @@ bool Client::Impl::ReadBlock(InputStream& input, Block* block) {
     std::string name;
     std::string type;
     for (size_t i = 0; i < num_columns; ++i) {
-        if (!WireFormat::ReadString(input, &name)) {
-            return false;
-        }
-        if (!WireFormat::ReadString(input, &type)) {
-            return false;
-        }
+        const ResultColumn* known = (result_columns && i < result_columns->size()) ? &(*result_columns)[i] : nullptr;
 
-        if (ColumnRef col = CreateColumnByType(type, create_column_settings)) {
-            if (num_rows && !col->Load(&input, num_rows)) {
-                throw ProtocolError("can't load column '" + name + "' of type " + type);
+        // Within a query the columns are usually the same in all blocks,
+        // so the header is first compared with the known one as is.
+        if (!known || !SkipIfNext(input, known->header)) {
+            if (!WireFormat::ReadString(input, &name)) {
+                return false;
             }
+            if (!WireFormat::ReadString(input, &type)) {
+                return false;
+            }
+            if (known && (known->name != name || known->type != type)) {
+                known = nullptr;
+            }
+        }
 
-            block->AppendColumn(name, col);
+        ColumnRef col;
+        if (known) {
+            if (reuse_result_columns_) {
+                col = known->column;
+                if (!num_rows) {
+                    col->Clear();
+                }
+            } else {
+                col = known->column->CloneEmpty();
+            }
+        } else if ((col = CreateColumnByType(type, create_column_settings))) {
+            if (result_columns) {
+                result_columns->resize(std::max<size_t>(result_columns->size(), i + 1));
+                (*result_columns)[i] = ResultColumn{name, type, EncodeColumnHeader(name, type),
+                        reuse_result_columns_ ? col : col->CloneEmpty()};
+                known = &(*result_columns)[i];
+            }
         } else {
             throw UnimplementedError(std::string("unsupported column type: ") + type);
         }
+
+        const std::string& column_name = known ? known->name : name;
+        if (num_rows && !col->Load(&input, num_rows)) {
+            throw ProtocolError("can't load column '" + column_name + "' of type " + (known ? known->type : type));
+        }
+
+        block->AppendColumn(column_name, col);
+    }
+
+    if (result_columns && result_columns->size() > num_columns) {
+        result_columns->resize(num_columns);
     }
 
     return true;
@@ -507,12 +724,24 @@ bool Client::Impl::ReceiveData() {
     }
 
     if (compression_ == CompressionState::Enable) {
-        CompressedInput compressed(input_.get());
-        if (!ReadBlock(compressed, &block)) {
+        bool read = false;
+        try {
+            read = ReadBlock(*compressed_input_, &block, &result_columns_);
+        } catch (...) {
+            compressed_input_->StopReadAhead();
+            throw;
+        }
+        // The rest of the packets are read from input_ directly.
+        compressed_input_->StopReadAhead();
+        if (!read) {
             return false;
         }
+        // Each block is compressed separately, nothing should be left of it.
+        if (!compressed_input_->Exhausted()) {
+            throw CompressionError("some data was not read");
+        }
     } else {
-        if (!ReadBlock(*input_, &block)) {
+        if (!ReadBlock(*input_, &block, &result_columns_)) {
             return false;
         }
     }
@@ -580,9 +809,14 @@ void Client::Impl::SendCancel() {
     output_->Flush();
 }
 
-void Client::Impl::SendQuery(const std::string& query, const std::string& query_id) {
+void Client::Impl::SendQuery(const Query& query, bool keep_blocks) {
+    // Columns are remembered only within a query, since the next one has its own
+    // and blocks of this one could be kept by the caller.
+    result_columns_.clear();
+    reuse_result_columns_ = options_.reuse_result_columns && !keep_blocks;
+
     WireFormat::WriteUInt64(*output_, ClientCodes::Query);
-    WireFormat::WriteString(*output_, query_id);
+    WireFormat::WriteString(*output_, query.GetQueryID());
 
     /// Client info.
     if (server_info_.revision >= DBMS_MIN_REVISION_WITH_CLIENT_INFO) {
@@ -616,14 +850,33 @@ void Client::Impl::SendQuery(const std::string& query, const std::string& query_
     }
 
     /// Per query settings.
-    //if (settings)
-    //    settings->serialize(*out);
-    //else
+    const auto& query_settings = query.GetQuerySettings();
+    if (server_info_.revision >= DBMS_MIN_REVISION_WITH_SETTINGS_SERIALIZED_AS_STRINGS) {
+        const auto write_setting = [this] (const std::string& name, const QuerySettingsField& field) {
+            WireFormat::WriteString(*output_, name);
+            WireFormat::WriteUInt64(*output_, field.flags);
+            WireFormat::WriteString(*output_, field.value);
+        };
+
+        for (const auto& [name, field] : options_.query_settings) {
+            if (query_settings.find(name) == query_settings.end()) {
+                write_setting(name, field);
+            }
+        }
+        for (const auto& [name, field] : query_settings) {
+            write_setting(name, field);
+        }
+    } else if (!query_settings.empty() || !options_.query_settings.empty()) {
+        // Older servers expect settings in a binary format specific to the type of each setting.
+        throw UnimplementedError("query settings are not supported by the server of revision "
+                                 + std::to_string(server_info_.revision));
+    }
+    // Empty string is a marker of the end of settings.
     WireFormat::WriteString(*output_, std::string());
 
     WireFormat::WriteUInt64(*output_, Stages::Complete);
     WireFormat::WriteUInt64(*output_, compression_);
-    WireFormat::WriteString(*output_, query);
+    WireFormat::WriteString(*output_, query.GetText());
     // Send empty block as marker of
     // end of data
     SendData(Block());
@@ -662,10 +915,12 @@ void Client::Impl::SendData(const Block& block) {
     }
 
     if (compression_ == CompressionState::Enable) {
-        assert(options_.compression_method == CompressionMethod::LZ4);
-
-        std::unique_ptr<OutputStream> compressed_output = std::make_unique<CompressedOutput>(output_.get(), options_.max_compression_chunk_size);
-        BufferedOutput buffered(std::move(compressed_output), options_.max_compression_chunk_size);
+        std::unique_ptr<OutputStream> compressed_output = std::make_unique<CompressedOutput>(
+                output_.get(), options_.max_compression_chunk_size, options_.compression_method, options_.compression_level,
+                compression_pool_.get());
+        // With parallel compression, a few chunks per thread are accumulated before being compressed at once.
+        const size_t chunks_per_write = compression_pool_ ? compression_pool_->GetThreadCount() * 4 : 1;
+        BufferedOutput buffered(std::move(compressed_output), options_.max_compression_chunk_size * chunks_per_write);
 
         WriteBlock(block, buffered);
     } else {
@@ -676,14 +931,29 @@ void Client::Impl::SendData(const Block& block) {
 }
 
 void Client::Impl::InitializeStreams(std::unique_ptr<SocketBase>&& socket) {
-    std::unique_ptr<OutputStream> output = std::make_unique<BufferedOutput>(socket->makeOutputStream());
-    std::unique_ptr<InputStream> input = std::make_unique<BufferedInput>(socket->makeInputStream());
-
+    // Columns are sent straight from their memory, along with the buffered headers.
+    std::unique_ptr<OutputStream> output = std::make_unique<GatherOutput>(socket->makeOutputStream());
+    // With read-ahead, a few compressed frames should fit into the buffer.
+    auto buffered_input = std::make_unique<BufferedInput>(socket->makeInputStream(),
+            options_.read_ahead_frames ? options_.read_ahead_frames * READ_AHEAD_BUFFER_PER_FRAME : 8192);
+    // Reused by all the blocks received over the connection.
+    auto compressed_input = std::make_unique<CompressedInput>(buffered_input.get(), options_.read_ahead_frames);
+    std::unique_ptr<InputStream> input = std::move(buffered_input);
+
+    // The previous CompressedInput stops reading ahead before its source is destroyed.
+    std::swap(compressed_input, compressed_input_);
+    compressed_input.reset();
     std::swap(input, input_);
     std::swap(output, output_);
     std::swap(socket, socket_);
 }
 
+void Client::Impl::CheckNoInsertInProgress() const {
+    if (insert_in_progress_) {
+        throw ValidationError("INSERT query is in progress, it must be finished before sending another query");
+    }
+}
+
 bool Client::Impl::SendHello() {
     WireFormat::WriteUInt64(*output_, ClientCodes::Hello);
     WireFormat::WriteString(*output_, std::string(DBMS_NAME) + " client");
@@ -817,6 +1087,19 @@ void Client::Insert(const std::string& table_name, const std::string& query_id,
     impl_->Insert(table_name, query_id, block);
 }
 
+Client::SelectStream Client::BeginSelect(const Query& query, size_t max_prefetched_blocks) {
+    return SelectStream(impl_.get(), query, max_prefetched_blocks);
+}
+
+Client::Inserter Client::BeginInsert(const std::string& table_name) {
+    return BeginInsert(table_name, Query::default_query_id);
+}
+
+Client::Inserter Client::BeginInsert(const std::string& table_name, const std::string& query_id) {
+    Block header = impl_->BeginInsert(Query("INSERT INTO " + table_name + " VALUES", query_id));
+    return Inserter(impl_.get(), std::move(header));
+}
+
 void Client::Ping() {
     impl_->Ping();
 }
@@ -829,4 +1112,186 @@ const ServerInfo& Client::GetServerInfo() const {
     return impl_->GetServerInfo();
 }
 
+Client::Inserter::Inserter(Impl* impl, Block header)
+    : impl_(impl)
+    , header_(std::move(header))
+{
+}
+
+Client::Inserter::Inserter(Inserter&& other) noexcept
+    : impl_(other.impl_)
+    , header_(std::move(other.header_))
+{
+    other.impl_ = nullptr;
+}
+
+Client::Inserter::~Inserter() {
+    if (impl_) {
+        impl_->AbortInsert();
+    }
+}
+
+const Block& Client::Inserter::GetHeader() const {
+    return header_;
+}
+
+void Client::Inserter::SendBlock(const Block& block) {
+    if (!impl_) {
+        throw ValidationError("INSERT is already finished");
+    }
+    try {
+        impl_->SendInsertData(block);
+    } catch (...) {
+        std::exchange(impl_, nullptr)->AbortInsert();
+        throw;
+    }
+}
+
+void Client::Inserter::Finish() {
+    if (!impl_) {
+        throw ValidationError("INSERT is already finished");
+    }
+    Impl* impl = std::exchange(impl_, nullptr);
+    try {
+        impl->EndInsert();
+    } catch (...) {
+        impl->AbortInsert();
+        throw;
+    }
+}
+
+struct Client::SelectStream::State {
+    State(size_t max_blocks)
+        : max_prefetched_blocks(std::max<size_t>(max_blocks, 1))
+    {
+    }
+
+    ~State() {
+        Cancel();
+    }
+
+    /// Called by the reader thread for every received block.
+    void Push(const Block& block) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] () { return blocks.size() < max_prefetched_blocks || cancelled; });
+
+        if (cancelled) {
+            // The rest of the result is skipped until the end of stream.
+            return;
+        }
+
+        blocks.push_back(block);
+        lock.unlock();
+        not_empty.notify_one();
+    }
+
+    /// Called by the reader thread for every received packet, true if the Cancel packet is to be sent.
+    bool TakeCancelRequest() {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Cancel packet is sent once.
+        return cancelled && !std::exchange(cancel_sent, true);
+    }
+
+    void Finish(std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            error = e;
+        }
+        not_empty.notify_all();
+    }
+
+    void Cancel() {
+        bool finished_before_cancel;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished_before_cancel = finished;
+            cancelled = true;
+            blocks.clear();
+        }
+        not_full.notify_all();
+
+        if (reader.joinable()) {
+            reader.join();
+        }
+
+        // Error caused by the cancellation itself is of no interest,
+        // while the one the query ended with before is still reported by Next().
+        if (!finished_before_cancel) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = nullptr;
+        }
+    }
+
+    const size_t max_prefetched_blocks;
+
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<Block> blocks;
+    bool finished = false;
+    bool cancelled = false;
+    bool cancel_sent = false;
+    std::exception_ptr error;
+
+    std::thread reader;
+};
+
+Client::SelectStream::SelectStream(Impl* impl, Query query, size_t max_prefetched_blocks)
+    : state_(std::make_unique<State>(max_prefetched_blocks))
+{
+    State* state = state_.get();
+
+    query.OnDataCancelable(SelectCancelableCallback());
+    query.OnData([state](const Block& block) {
+        // Skip the header and other blocks without data.
+        if (block.GetRowCount() != 0) {
+            state->Push(block);
+        }
+    });
+
+    state->reader = std::thread([impl, state, query = std::move(query)] () {
+        try {
+            impl->ExecuteQuery(query, true, [state] () { return state->TakeCancelRequest(); });
+            state->Finish(nullptr);
+        } catch (...) {
+            state->Finish(std::current_exception());
+        }
+    });
+}
+
+Client::SelectStream::SelectStream(SelectStream&& other) noexcept = default;
+
+Client::SelectStream& Client::SelectStream::operator=(SelectStream&& other) noexcept = default;
+
+Client::SelectStream::~SelectStream() = default;
+
+std::optional<Block> Client::SelectStream::Next() {
+    if (!state_) {
+        throw ValidationError("SelectStream is moved out");
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->not_empty.wait(lock, [this] () { return !state_->blocks.empty() || state_->finished; });
+
+    if (!state_->blocks.empty()) {
+        Block block = std::move(state_->blocks.front());
+        state_->blocks.pop_front();
+        lock.unlock();
+        state_->not_full.notify_one();
+        return block;
+    }
+
+    if (state_->error) {
+        std::rethrow_exception(std::exchange(state_->error, nullptr));
+    }
+    return std::nullopt;
+}
+
+void Client::SelectStream::Cancel() {
+    if (state_) {
+        state_->Cancel();
+    }
+}
+
 }
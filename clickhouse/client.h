@@ -2,6 +2,7 @@
 
 #include "query.h"
 #include "exceptions.h"
+#include "protocol.h"
 
 #include "columns/array.h"
 #include "columns/date.h"
@@ -36,12 +37,6 @@ struct ServerInfo {
     uint64_t    revision;
 };
 
-/// Methods of block compression.
-enum class CompressionMethod {
-    None    = -1,
-    LZ4     =  1,
-};
-
 struct ClientOptions {
 #define DECLARE_FIELD(name, type, setter, default_value) \
     type name = default_value; \
@@ -74,8 +69,34 @@ struct ClientOptions {
     /// Amount of time to wait before next retry.
     DECLARE_FIELD(retry_timeout, std::chrono::seconds, SetRetryTimeout, std::chrono::seconds(5));
 
-    /// Compression method.
+    /// Settings sent with every query, per query settings of the same name take precedence.
+    DECLARE_FIELD(query_settings, QuerySettings, SetQuerySettings, QuerySettings());
+
+    /** Compression method.
+     *  Data sent by the server is compressed with the method set by `network_compression_method`
+     *  setting of the server (LZ4 by default), which could be changed with query_settings.
+     *  ZSTD is available only if the library is built WITH_ZSTD.
+     */
     DECLARE_FIELD(compression_method, CompressionMethod, SetCompressionMethod, CompressionMethod::None);
+    /// Level of ZSTD compression, 0 means the default level of ZSTD library.
+    DECLARE_FIELD(compression_level, int, SetCompressionLevel, 0);
+    /** Number of threads compressing chunks of a block being sent in parallel,
+     *  including the thread calling Insert(). 1 means compress sequentially on the calling thread.
+     *  Only blocks larger than max_compression_chunk_size benefit from that.
+     */
+    DECLARE_FIELD(compression_threads, unsigned int, SetCompressionThreads, 1);
+    /** Number of compressed frames received from the server which are checked and decompressed
+     *  on a background thread while the current one is parsed, 0 disables read-ahead.
+     *  Takes a larger receive buffer, so that a few frames are read from the socket at once.
+     */
+    DECLARE_FIELD(read_ahead_frames, unsigned int, SetReadAheadFrames, 0);
+    /** Columns of blocks received by a query are kept by the client and loaded again for the following blocks
+     *  with the same columns, reusing memory allocated for them.
+     *  Blocks passed to the OnData callbacks and their columns are then valid only until the callback returns,
+     *  columns have to be copied (i.e. with Slice()) to keep the data.
+     *  Not applied to queries started with Client::BeginSelect(), which keeps the blocks for the consumer.
+     */
+    DECLARE_FIELD(reuse_result_columns, bool, SetReuseResultColumns, false);
 
     /// TCP Keep alive options
     DECLARE_FIELD(tcp_keepalive, bool, TcpKeepAlive, false);
@@ -197,6 +218,77 @@ class SocketFactory;
  *
  */
 class Client {
+    class Impl;
+
+public:
+    /** Keeps a single INSERT query open, so any number of blocks could be sent
+     *  without a full query round trip per block.
+     *
+     *  Created with Client::BeginInsert(), the query is completed with Finish().
+     *  If the inserter is destroyed before Finish() is called, or SendBlock() or Finish() throws,
+     *  the query is aborted by resetting the connection, note that blocks sent so far may have been
+     *  already written by the server. The inserter can't be used after an exception.
+     *
+     *  The Client must outlive the inserter and must not be used for anything else
+     *  until the insert is finished.
+     */
+    class Inserter {
+    public:
+        Inserter(Inserter&& other) noexcept;
+        ~Inserter();
+
+        Inserter(const Inserter&) = delete;
+        Inserter& operator=(const Inserter&) = delete;
+        Inserter& operator=(Inserter&&) = delete;
+
+        /// Structure of the data expected by the server: names and types of the columns, no rows.
+        const Block& GetHeader() const;
+
+        /// Sends one more block of data, columns should match the header.
+        void SendBlock(const Block& block);
+
+        /// Sends end of data marker and waits for server to complete the query.
+        void Finish();
+
+    private:
+        friend class Client;
+        Inserter(Impl* impl, Block header);
+
+        Impl* impl_;
+        Block header_;
+    };
+
+    /** Pulls result blocks of a SELECT query one by one.
+     *
+     *  Blocks are received and decoded by a background thread up to `max_prefetched_blocks`
+     *  ahead of the consumer, so the network I/O and decoding overlap with processing of the blocks.
+     *  Callbacks of the query, like OnProgress() or OnException(), are called from that thread.
+     *
+     *  The Client must outlive the stream and must not be used for anything else until
+     *  Next() returns no block, or the stream is cancelled or destroyed.
+     */
+    class SelectStream {
+    public:
+        SelectStream(SelectStream&& other) noexcept;
+        SelectStream& operator=(SelectStream&& other) noexcept;
+        /// Cancels the query if the result is not received completely.
+        ~SelectStream();
+
+        /// Next non-empty block of the result, or nothing once the whole result is received.
+        /// Rethrows an exception thrown while executing the query.
+        std::optional<Block> Next();
+
+        /// Cancels the query and waits until the server acknowledges that, blocks not consumed yet are dropped.
+        void Cancel();
+
+    private:
+        friend class Client;
+        struct State;
+        SelectStream(Impl* impl, Query query, size_t max_prefetched_blocks);
+
+        std::unique_ptr<State> state_;
+    };
+
 public:
      Client(const ClientOptions& opts);
      Client(const ClientOptions& opts,
@@ -219,10 +311,19 @@ public:
     /// Alias for Execute.
     void Select(const Query& query);
 
+    /// Starts a select query and returns a stream to pull the result blocks from,
+    /// up to \p max_prefetched_blocks blocks are received ahead of the consumer.
+    SelectStream BeginSelect(const Query& query, size_t max_prefetched_blocks = 4);
+
     /// Intends for insert block of data into a table \p table_name.
     void Insert(const std::string& table_name, const Block& block);
     void Insert(const std::string& table_name, const std::string& query_id, const Block& block);
 
+    /// Starts an INSERT into all columns of a table \p table_name and returns
+    /// an Inserter to stream any number of blocks over that single query.
+    Inserter BeginInsert(const std::string& table_name);
+    Inserter BeginInsert(const std::string& table_name, const std::string& query_id);
+
     /// Ping server for aliveness.
     void Ping();
 
@@ -234,7 +335,6 @@ public:
 private:
     const ClientOptions options_;
 
-    class Impl;
     std::unique_ptr<Impl> impl_;
 };
 
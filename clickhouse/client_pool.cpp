@@ -0,0 +1,208 @@
+#include "client_pool.h"
+
+#include <cassert>
+#include <exception>
+
+namespace clickhouse {
+
+ClientPool::Lease::Lease(ClientPool* pool, std::unique_ptr<Client> client)
+    : pool_(pool)
+    , client_(std::move(client))
+    , uncaught_exceptions_(std::uncaught_exceptions())
+{
+}
+
+ClientPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_)
+    , client_(std::move(other.client_))
+    , uncaught_exceptions_(other.uncaught_exceptions_)
+{
+}
+
+ClientPool::Lease& ClientPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        Release();
+
+        pool_ = other.pool_;
+        client_ = std::move(other.client_);
+        uncaught_exceptions_ = other.uncaught_exceptions_;
+    }
+    return *this;
+}
+
+ClientPool::Lease::~Lease() {
+    // If the lease is destroyed while an exception propagates, the query in progress
+    // was most likely interrupted, so the connection can't be trusted anymore.
+    Return(std::uncaught_exceptions() <= uncaught_exceptions_);
+}
+
+void ClientPool::Lease::Release() {
+    Return(true);
+}
+
+void ClientPool::Lease::Discard() {
+    Return(false);
+}
+
+void ClientPool::Lease::Return(bool reusable) {
+    if (client_) {
+        pool_->Return(std::move(client_), reusable);
+    }
+}
+
+
+ClientPool::ClientPool(const ClientPoolOptions& options)
+    : options_(options)
+    , size_(0)
+{
+    if (options_.max_size == 0) {
+        throw ValidationError("max_size of the ClientPool must be greater than 0");
+    }
+}
+
+ClientPool::~ClientPool() {
+    assert(size_ == idle_.size() && "ClientPool destroyed while some connections are still leased");
+}
+
+ClientPool::Lease ClientPool::Acquire() {
+    using Clock = std::chrono::steady_clock;
+
+    const auto deadline = Clock::now() + options_.acquire_timeout;
+    bool waited = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Expired connections are closed with the lock released.
+        std::deque<IdleClient> expired;
+        CollectExpired(Clock::now(), &expired);
+
+        if (!idle_.empty()) {
+            // Reuse the most recently returned connection, it is the least likely to be dropped by the server.
+            IdleClient candidate = std::move(idle_.back());
+            idle_.pop_back();
+
+            const bool need_ping = Clock::now() - candidate.idle_since >= options_.ping_after_idle_time;
+            lock.unlock();
+            expired.clear();
+
+            if (need_ping) {
+                try {
+                    candidate.client->Ping();
+                } catch (const std::exception&) {
+                    candidate.client.reset();
+
+                    lock.lock();
+                    --size_;
+                    ++stats_.connections_failed_ping;
+                    // Leave a room for a new connection to be established.
+                    continue;
+                }
+            }
+
+            lock.lock();
+            ++stats_.acquired;
+            return Lease(this, std::move(candidate.client));
+        }
+
+        if (size_ < options_.max_size) {
+            // Reserve a slot, so other threads do not exceed max_size while the connection is being established.
+            ++size_;
+            lock.unlock();
+            expired.clear();
+
+            std::unique_ptr<Client> client;
+            try {
+                client = std::make_unique<Client>(options_.client_options);
+            } catch (...) {
+                lock.lock();
+                --size_;
+                lock.unlock();
+                returned_.notify_one();
+                throw;
+            }
+
+            lock.lock();
+            ++stats_.connections_created;
+            ++stats_.acquired;
+            return Lease(this, std::move(client));
+        }
+
+        if (!expired.empty()) {
+            lock.unlock();
+            expired.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (!waited) {
+            waited = true;
+            ++stats_.waited;
+        }
+
+        const auto wait_started_at = Clock::now();
+        const auto status = returned_.wait_until(lock, deadline);
+        stats_.wait_time += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - wait_started_at);
+
+        if (status == std::cv_status::timeout && idle_.empty() && size_ >= options_.max_size) {
+            ++stats_.timed_out;
+            throw Error("Timed out waiting for a free connection in ClientPool, all "
+                    + std::to_string(options_.max_size) + " connections are leased");
+        }
+    }
+}
+
+void ClientPool::EvictIdle() {
+    std::deque<IdleClient> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CollectExpired(std::chrono::steady_clock::now(), &expired);
+    }
+}
+
+ClientPoolStats ClientPool::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ClientPoolStats stats = stats_;
+    stats.idle = idle_.size();
+    stats.leased = size_ - idle_.size();
+
+    return stats;
+}
+
+const ClientPoolOptions& ClientPool::GetOptions() const {
+    return options_;
+}
+
+void ClientPool::Return(std::unique_ptr<Client> client, bool reusable) {
+    const auto now = std::chrono::steady_clock::now();
+
+    std::deque<IdleClient> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (reusable) {
+            idle_.push_back(IdleClient{std::move(client), now});
+        } else {
+            --size_;
+            ++stats_.connections_discarded;
+        }
+
+        CollectExpired(now, &expired);
+    }
+    returned_.notify_one();
+
+    // `client` (if discarded) and `expired` are closed here, with the lock released.
+}
+
+void ClientPool::CollectExpired(std::chrono::steady_clock::time_point now, std::deque<IdleClient>* expired) {
+    // Connections at the front were idle for the longest time.
+    while (!idle_.empty() && now - idle_.front().idle_since >= options_.max_idle_time) {
+        expired->push_back(std::move(idle_.front()));
+        idle_.pop_front();
+
+        --size_;
+        ++stats_.connections_evicted;
+    }
+}
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "client.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace clickhouse {
+
+struct ClientPoolOptions {
+#define DECLARE_FIELD(name, type, setter, default_value) \
+    type name = default_value; \
+    inline auto & setter(const type& value) { \
+        name = value; \
+        return *this; \
+    }
+
+    /// Options used to establish every connection of the pool.
+    DECLARE_FIELD(client_options, ClientOptions, SetClientOptions, ClientOptions());
+
+    /// Max number of connections, both leased and idle, the pool may hold at once.
+    DECLARE_FIELD(max_size, size_t, SetMaxSize, 8);
+
+    /// Idle connections which were not used for that long are closed.
+    DECLARE_FIELD(max_idle_time, std::chrono::seconds, SetMaxIdleTime, std::chrono::seconds(300));
+
+    /// Idle connections which were not used for that long are checked with Ping() before being leased.
+    /// Set to zero to ping on every checkout.
+    DECLARE_FIELD(ping_after_idle_time, std::chrono::milliseconds, SetPingAfterIdleTime, std::chrono::seconds(10));
+
+    /// How long Acquire() waits for a connection to be returned when all of them are leased.
+    DECLARE_FIELD(acquire_timeout, std::chrono::milliseconds, SetAcquireTimeout, std::chrono::seconds(30));
+
+#undef DECLARE_FIELD
+};
+
+struct ClientPoolStats {
+    /// Connections waiting in the pool to be leased.
+    size_t idle = 0;
+    /// Connections currently leased out (or being established).
+    size_t leased = 0;
+
+    /// Number of successful Acquire() calls.
+    uint64_t acquired = 0;
+    /// Number of Acquire() calls which had to wait for a connection to be returned.
+    uint64_t waited = 0;
+    /// Number of Acquire() calls which failed due to acquire_timeout.
+    uint64_t timed_out = 0;
+    /// Total time spent by Acquire() waiting for a connection to be returned.
+    std::chrono::microseconds wait_time{0};
+
+    /// Number of connections established by the pool.
+    uint64_t connections_created = 0;
+    /// Number of idle connections closed due to max_idle_time.
+    uint64_t connections_evicted = 0;
+    /// Number of connections closed because they failed the Ping() health check.
+    uint64_t connections_failed_ping = 0;
+    /// Number of connections discarded by the user or due to an exception while leased.
+    uint64_t connections_discarded = 0;
+};
+
+/** Thread-safe pool of Client connections.
+ *
+ *  Client is not thread-safe, so each thread normally needs its own connection,
+ *  which in turn costs a full handshake whenever a thread starts.
+ *  ClientPool lets any number of threads share at most `max_size` warm connections:
+ *  a connection is leased with Acquire() and returned to the pool once the Lease goes out of scope.
+ *
+ *  The pool must outlive all of its leases.
+ */
+class ClientPool {
+public:
+    /// RAII handle of a leased connection.
+    class Lease {
+    public:
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        inline Client& operator*() const { return *client_; }
+        inline Client* operator->() const { return client_.get(); }
+
+        /// Returns the connection to the pool before the lease goes out of scope.
+        void Release();
+
+        /// Closes the connection instead of returning it to the pool, e.g. when it is left
+        /// in an unknown state by a network or protocol error.
+        /// Done automatically if the lease is destroyed due to an exception.
+        void Discard();
+
+    private:
+        friend class ClientPool;
+        Lease(ClientPool* pool, std::unique_ptr<Client> client);
+
+        void Return(bool reusable);
+
+    private:
+        ClientPool* pool_;
+        std::unique_ptr<Client> client_;
+        int uncaught_exceptions_;
+    };
+
+public:
+    explicit ClientPool(const ClientPoolOptions& options);
+    ~ClientPool();
+
+    ClientPool(const ClientPool&) = delete;
+    ClientPool& operator=(const ClientPool&) = delete;
+
+    /// Leases a connection: reuses an idle one if there is any, otherwise establishes a new one
+    /// unless the pool is full, in which case waits up to `acquire_timeout` for a connection to be returned.
+    Lease Acquire();
+
+    /// Closes connections that were idle for longer than `max_idle_time`.
+    /// Also done on every Acquire() and every return of a connection to the pool.
+    void EvictIdle();
+
+    ClientPoolStats GetStats() const;
+
+    const ClientPoolOptions& GetOptions() const;
+
+private:
+    struct IdleClient {
+        std::unique_ptr<Client> client;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
+    void Return(std::unique_ptr<Client> client, bool reusable);
+    void CollectExpired(std::chrono::steady_clock::time_point now, std::deque<IdleClient>* expired);
+
+private:
+    const ClientPoolOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable returned_;
+    /// Most recently returned connections are at the back.
+    std::deque<IdleClient> idle_;
+    /// Count of idle, leased and being established connections.
+    size_t size_;
+    ClientPoolStats stats_;
+};
+
+}
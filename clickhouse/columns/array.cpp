@@ -11,6 +11,13 @@ ColumnArray::ColumnArray(ColumnRef data)
 {
 }
 
+ColumnArray::ColumnArray(TypeRef type, ColumnRef data)
+    : Column(std::move(type))
+    , data_(std::move(data))
+    , offsets_(std::make_shared<ColumnUInt64>())
+{
+}
+
 void ColumnArray::AppendAsColumn(ColumnRef array) {
     if (!data_->Type()->IsEqual(array->Type())) {
         throw ValidationError(
@@ -42,6 +49,10 @@ ColumnRef ColumnArray::Slice(size_t begin, size_t size) const {
     return result;
 }
 
+ColumnRef ColumnArray::CloneEmpty() const {
+    return ColumnRef{new ColumnArray(type_, data_->CloneEmpty())};
+}
+
 void ColumnArray::Append(ColumnRef column) {
     if (auto col = column->As<ColumnArray>()) {
         if (!col->data_->Type()->IsEqual(data_->Type())) {
@@ -56,6 +67,7 @@ void ColumnArray::Append(ColumnRef column) {
 
 bool ColumnArray::Load(InputStream* input, size_t rows) {
     if (!rows) {
+        Clear();
         return true;
     }
     if (!offsets_->Load(input, rows)) {
@@ -77,6 +89,16 @@ void ColumnArray::Clear() {
     data_->Clear();
 }
 
+void ColumnArray::Reserve(size_t new_cap) {
+    // Number of nested rows is not known.
+    offsets_->Reserve(new_cap);
+}
+
+void ColumnArray::ShrinkToFit() {
+    offsets_->ShrinkToFit();
+    data_->ShrinkToFit();
+}
+
 size_t ColumnArray::Size() const {
     return offsets_->Size();
 }
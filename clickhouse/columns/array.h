@@ -33,17 +33,28 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of the current column.
     ColumnRef Slice(size_t, size_t) const override;
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column&) override;
 
     void OffsetsIncrease(size_t);
 
 private:
+    ColumnArray(TypeRef type, ColumnRef data);
+
     size_t GetOffset(size_t n) const;
 
     size_t GetSize(size_t n) const;
@@ -48,15 +48,29 @@ public:
     /// Saves column data to output stream.
     virtual void Save(OutputStream* output) = 0;
 
-    /// Clear column data .
+    /// Clear column data, keeping allocated memory for reuse.
     virtual void Clear() = 0;
 
+    /// Reserves memory for \p new_cap rows of the column, including the present ones.
+    /// Does nothing unless supported by column.
+    virtual void Reserve(size_t /*new_cap*/) { }
+
+    /// Releases memory which is not used by the column data.
+    /// Does nothing unless supported by column.
+    virtual void ShrinkToFit() { }
+
     /// Returns count of rows in the column.
     virtual size_t Size() const = 0;
 
     /// Makes slice of the current column.
     virtual ColumnRef Slice(size_t begin, size_t len) const = 0;
 
+    /// Makes an empty column of the same type, sharing type metadata with the current one.
+    /// Will throw an exception if not supported by column.
+    virtual ColumnRef CloneEmpty() const {
+        throw UnimplementedError("CloneEmpty() is not supported for column of " + type_->GetName());
+    }
+
     virtual void Swap(Column&) = 0;
 
     /// Get a view on raw item data if it is supported by column, will throw an exception if index is out of range.
@@ -17,10 +17,28 @@ void ColumnDate::Clear() {
     data_->Clear();
 }
 
+void ColumnDate::Reserve(size_t new_cap) {
+    data_->Reserve(new_cap);
+}
+
+void ColumnDate::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
+
 std::time_t ColumnDate::At(size_t n) const {
     return static_cast<std::time_t>(data_->At(n)) * 86400;
 }
 
+template <typename T>
+void ColumnDate::Gather(const ColumnDate & dictionary, const ColumnVector<T> & index) {
+    data_->Gather(*dictionary.data_, index);
+}
+
+template void ColumnDate::Gather(const ColumnDate &, const ColumnUInt8 &);
+template void ColumnDate::Gather(const ColumnDate &, const ColumnUInt16 &);
+template void ColumnDate::Gather(const ColumnDate &, const ColumnUInt32 &);
+template void ColumnDate::Gather(const ColumnDate &, const ColumnUInt64 &);
+
 void ColumnDate::Append(ColumnRef column) {
     if (auto col = column->As<ColumnDate>()) {
         data_->Append(col->data_);
@@ -48,6 +66,10 @@ ColumnRef ColumnDate::Slice(size_t begin, size_t len) const {
     return result;
 }
 
+ColumnRef ColumnDate::CloneEmpty() const {
+    return std::make_shared<ColumnDate>();
+}
+
 void ColumnDate::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnDate &>(other);
     data_.swap(col.data_);
@@ -71,6 +93,12 @@ ColumnDateTime::ColumnDateTime(std::string timezone)
 {
 }
 
+ColumnDateTime::ColumnDateTime(TypeRef type)
+    : Column(std::move(type))
+    , data_(std::make_shared<ColumnUInt32>())
+{
+}
+
 void ColumnDateTime::Append(const std::time_t& value) {
     data_->Append(static_cast<uint32_t>(value));
 }
@@ -83,6 +111,16 @@ std::string ColumnDateTime::Timezone() const {
     return type_->As<DateTimeType>()->Timezone();
 }
 
+template <typename T>
+void ColumnDateTime::Gather(const ColumnDateTime & dictionary, const ColumnVector<T> & index) {
+    data_->Gather(*dictionary.data_, index);
+}
+
+template void ColumnDateTime::Gather(const ColumnDateTime &, const ColumnUInt8 &);
+template void ColumnDateTime::Gather(const ColumnDateTime &, const ColumnUInt16 &);
+template void ColumnDateTime::Gather(const ColumnDateTime &, const ColumnUInt32 &);
+template void ColumnDateTime::Gather(const ColumnDateTime &, const ColumnUInt64 &);
+
 void ColumnDateTime::Append(ColumnRef column) {
     if (auto col = column->As<ColumnDateTime>()) {
         data_->Append(col->data_);
@@ -105,15 +143,27 @@ void ColumnDateTime::Clear() {
     data_->Clear();
 }
 
+void ColumnDateTime::Reserve(size_t new_cap) {
+    data_->Reserve(new_cap);
+}
+
+void ColumnDateTime::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
+
 ColumnRef ColumnDateTime::Slice(size_t begin, size_t len) const {
     auto col = data_->Slice(begin, len)->As<ColumnUInt32>();
-    auto result = std::make_shared<ColumnDateTime>();
+    auto result = std::make_shared<ColumnDateTime>(Timezone());
 
     result->data_->Append(col);
 
     return result;
 }
 
+ColumnRef ColumnDateTime::CloneEmpty() const {
+    return ColumnRef{new ColumnDateTime(type_)};
+}
+
 void ColumnDateTime::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnDateTime &>(other);
     data_.swap(col.data_);
@@ -173,6 +223,14 @@ void ColumnDateTime64::Save(OutputStream* output) {
 void ColumnDateTime64::Clear() {
     data_->Clear();
 }
+
+void ColumnDateTime64::Reserve(size_t new_cap) {
+    data_->Reserve(new_cap);
+}
+
+void ColumnDateTime64::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
 size_t ColumnDateTime64::Size() const {
     return data_->Size();
 }
@@ -197,6 +255,10 @@ ColumnRef ColumnDateTime64::Slice(size_t begin, size_t len) const {
     return ColumnRef{new ColumnDateTime64(type_, sliced_data)};
 }
 
+ColumnRef ColumnDateTime64::CloneEmpty() const {
+    return ColumnRef{new ColumnDateTime64(type_, data_->CloneEmpty()->As<ColumnDecimal>())};
+}
+
 size_t ColumnDateTime64::GetPrecision() const {
     return precision_;
 }
@@ -22,6 +22,10 @@ public:
     /// TODO: The implementation is fundamentally wrong.
     std::time_t At(size_t n) const;
 
+    /// Appends items of \p dictionary at positions given by \p index.
+    template <typename T>
+    void Gather(const ColumnDate & dictionary, const ColumnVector<T> & index);
+
     /// Appends content of given column to the end of current one.
     void Append(ColumnRef column) override;
 
@@ -34,12 +38,21 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
 
     ItemView GetItem(size_t index) const override;
@@ -65,6 +78,10 @@ public:
     /// Timezone associated with a data column.
     std::string Timezone() const;
 
+    /// Appends items of \p dictionary at positions given by \p index.
+    template <typename T>
+    void Gather(const ColumnDateTime & dictionary, const ColumnVector<T> & index);
+
 public:
     /// Appends content of given column to the end of current one.
     void Append(ColumnRef column) override;
@@ -75,6 +92,12 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Saves column data to output stream.
     void Save(OutputStream* output) override;
 
@@ -84,10 +107,16 @@ public:
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
 
     ItemView GetItem(size_t index) const override;
 
+private:
+    explicit ColumnDateTime(TypeRef type);
+
 private:
     std::shared_ptr<ColumnUInt32> data_;
 };
@@ -123,6 +152,12 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Saves column data to output stream.
     void Save(OutputStream* output) override;
 
@@ -132,6 +167,9 @@ public:
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
 
     ItemView GetItem(size_t index) const override;
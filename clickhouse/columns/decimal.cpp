@@ -209,6 +209,14 @@ void ColumnDecimal::Clear() {
     data_->Clear();
 }
 
+void ColumnDecimal::Reserve(size_t new_cap) {
+    data_->Reserve(new_cap);
+}
+
+void ColumnDecimal::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
+
 size_t ColumnDecimal::Size() const {
     return data_->Size();
 }
@@ -218,6 +226,10 @@ ColumnRef ColumnDecimal::Slice(size_t begin, size_t len) const {
     return ColumnRef{new ColumnDecimal(type_, data_->Slice(begin, len))};
 }
 
+ColumnRef ColumnDecimal::CloneEmpty() const {
+    return ColumnRef{new ColumnDecimal(type_, data_->CloneEmpty())};
+}
+
 void ColumnDecimal::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnDecimal &>(other);
     data_.swap(col.data_);
@@ -24,8 +24,12 @@ public:
     bool Load(InputStream* input, size_t rows) override;
     void Save(OutputStream* output) override;
     void Clear() override;
+    void Reserve(size_t new_cap) override;
+    void ShrinkToFit() override;
     size_t Size() const override;
     ColumnRef Slice(size_t begin, size_t len) const override;
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
     ItemView GetItem(size_t index) const override;
 
@@ -38,6 +38,16 @@ void ColumnEnum<T>::Clear() {
     data_.clear();
 }
 
+template <typename T>
+void ColumnEnum<T>::Reserve(size_t new_cap) {
+    data_.reserve(new_cap);
+}
+
+template <typename T>
+void ColumnEnum<T>::ShrinkToFit() {
+    data_.shrink_to_fit();
+}
+
 template <typename T>
 const T& ColumnEnum<T>::At(size_t n) const {
     return data_.at(n);
@@ -81,7 +91,7 @@ bool ColumnEnum<T>::Load(InputStream* input, size_t rows) {
 
 template <typename T>
 void ColumnEnum<T>::Save(OutputStream* output) {
-    WireFormat::WriteBytes(*output, data_.data(), data_.size() * sizeof(T));
+    WireFormat::WriteBytesRef(*output, data_.data(), data_.size() * sizeof(T));
 }
 
 template <typename T>
@@ -94,6 +104,11 @@ ColumnRef ColumnEnum<T>::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnEnum<T>>(type_, SliceVector(data_, begin, len));
 }
 
+template <typename T>
+ColumnRef ColumnEnum<T>::CloneEmpty() const {
+    return std::make_shared<ColumnEnum<T>>(type_);
+}
+
 template <typename T>
 void ColumnEnum<T>::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnEnum<T> &>(other);
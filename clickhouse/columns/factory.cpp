@@ -20,6 +20,7 @@
 #include "../exceptions.h"
 
 #include <stdexcept>
+#include <unordered_map>
 
 namespace clickhouse {
 namespace {
@@ -99,6 +100,42 @@ static ColumnRef CreateTerminalColumn(const TypeAst& ast) {
     }
 }
 
+// Whether values of the type could be stored in a dictionary of LowCardinality column.
+// Decimal and Enum are not accepted as LowCardinality dictionaries by the server,
+// UUID, IPv4 and IPv6 only by its recent versions, so they are not supported yet.
+static bool IsLowCardinalityDictionaryType(const TypeAst& ast) {
+    if (ast.meta != TypeAst::Terminal)
+        return false;
+
+    switch (ast.code) {
+    case Type::Int8:
+    case Type::Int16:
+    case Type::Int32:
+    case Type::Int64:
+    case Type::UInt8:
+    case Type::UInt16:
+    case Type::UInt32:
+    case Type::UInt64:
+    case Type::Float32:
+    case Type::Float64:
+    case Type::Date:
+    case Type::DateTime:
+    case Type::String:
+    case Type::FixedString:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <typename ColumnType, typename ...Args>
+static ColumnRef CreateLowCardinalityColumn(const CreateColumnByTypeSettings& settings, Args&&... args) {
+    if (settings.low_cardinality_as_wrapped_column) {
+        return std::make_shared<LowCardinalitySerializationAdaptor<ColumnType>>(std::forward<Args>(args)...);
+    }
+    return std::make_shared<ColumnLowCardinalityT<ColumnType>>(std::forward<Args>(args)...);
+}
+
 static ColumnRef CreateColumnFromAst(const TypeAst& ast, CreateColumnByTypeSettings settings) {
     switch (ast.meta) {
         case TypeAst::Array: {
@@ -156,27 +193,54 @@ static ColumnRef CreateColumnFromAst(const TypeAst& ast, CreateColumnByTypeSetti
         }
         case TypeAst::LowCardinality: {
             const auto nested = ast.elements.front();
-            if (settings.low_cardinality_as_wrapped_column) {
-                switch (nested.code) {
-                    // TODO (nemkov): update this to maximize code reuse.
-                    case Type::String:
-                        return std::make_shared<LowCardinalitySerializationAdaptor<ColumnString>>();
-                    case Type::FixedString:
-                        return std::make_shared<LowCardinalitySerializationAdaptor<ColumnFixedString>>(nested.elements.front().value);
-                    default:
-                        throw UnimplementedError("LowCardinality(" + nested.name + ") is not supported");
+            if (nested.meta == TypeAst::Nullable) {
+                // There is no typed interface for Nullable dictionary, values are accessed with GetItem().
+                if (!IsLowCardinalityDictionaryType(nested.elements.front()))
+                    throw UnimplementedError("LowCardinality(" + nested.name + ") is not supported");
+
+                auto dictionary = CreateColumnFromAst(nested, settings)->As<ColumnNullable>();
+                if (settings.low_cardinality_as_wrapped_column) {
+                    return std::make_shared<LowCardinalitySerializationAdaptor<ColumnNullable>>(
+                            dictionary->Nested(), dictionary->Nulls());
                 }
+                return std::make_shared<ColumnLowCardinality>(dictionary);
             }
-            else {
-                switch (nested.code) {
-                    // TODO (nemkov): update this to maximize code reuse.
-                    case Type::String:
-                        return std::make_shared<ColumnLowCardinalityT<ColumnString>>();
-                    case Type::FixedString:
-                        return std::make_shared<ColumnLowCardinalityT<ColumnFixedString>>(nested.elements.front().value);
-                    default:
-                        throw UnimplementedError("LowCardinality(" + nested.name + ") is not supported");
-                }
+
+            switch (nested.code) {
+                case Type::String:
+                    return CreateLowCardinalityColumn<ColumnString>(settings);
+                case Type::FixedString:
+                    return CreateLowCardinalityColumn<ColumnFixedString>(settings, nested.elements.front().value);
+                case Type::Int8:
+                    return CreateLowCardinalityColumn<ColumnInt8>(settings);
+                case Type::Int16:
+                    return CreateLowCardinalityColumn<ColumnInt16>(settings);
+                case Type::Int32:
+                    return CreateLowCardinalityColumn<ColumnInt32>(settings);
+                case Type::Int64:
+                    return CreateLowCardinalityColumn<ColumnInt64>(settings);
+                case Type::UInt8:
+                    return CreateLowCardinalityColumn<ColumnUInt8>(settings);
+                case Type::UInt16:
+                    return CreateLowCardinalityColumn<ColumnUInt16>(settings);
+                case Type::UInt32:
+                    return CreateLowCardinalityColumn<ColumnUInt32>(settings);
+                case Type::UInt64:
+                    return CreateLowCardinalityColumn<ColumnUInt64>(settings);
+                case Type::Float32:
+                    return CreateLowCardinalityColumn<ColumnFloat32>(settings);
+                case Type::Float64:
+                    return CreateLowCardinalityColumn<ColumnFloat64>(settings);
+                case Type::Date:
+                    return CreateLowCardinalityColumn<ColumnDate>(settings);
+                case Type::DateTime:
+                    if (nested.elements.empty()) {
+                        return CreateLowCardinalityColumn<ColumnDateTime>(settings);
+                    } else {
+                        return CreateLowCardinalityColumn<ColumnDateTime>(settings, nested.elements[0].value_string);
+                    }
+                default:
+                    throw UnimplementedError("LowCardinality(" + nested.name + ") is not supported");
             }
         }
         case TypeAst::SimpleAggregateFunction: {
@@ -197,12 +261,28 @@ static ColumnRef CreateColumnFromAst(const TypeAst& ast, CreateColumnByTypeSetti
 
 
 ColumnRef CreateColumnByType(const std::string& type_name, CreateColumnByTypeSettings settings) {
-    auto ast = ParseTypeName(type_name);
-    if (ast != nullptr) {
-        return CreateColumnFromAst(*ast, settings);
+    // Columns are cloned from prototypes built once per thread for each type name and settings,
+    // so creating a column takes no locks and allocates no type metadata.
+    // Like the parsed type names, prototypes are never evicted.
+    // Prototypes are made by CreateColumnFromAst() only, so all of them implement CloneEmpty().
+    thread_local std::unordered_map<std::string, ColumnRef> prototypes[2];
+
+    auto& cache = prototypes[settings.low_cardinality_as_wrapped_column ? 1 : 0];
+    auto it = cache.find(type_name);
+    if (it == cache.end()) {
+        auto ast = ParseTypeName(type_name);
+        if (ast == nullptr) {
+            return nullptr;
+        }
+
+        auto prototype = CreateColumnFromAst(*ast, settings);
+        if (prototype == nullptr) {
+            return nullptr;
+        }
+        it = cache.emplace(type_name, std::move(prototype)).first;
     }
 
-    return nullptr;
+    return it->second->CloneEmpty();
 }
 
 }
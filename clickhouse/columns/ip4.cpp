@@ -38,6 +38,14 @@ void ColumnIPv4::Clear() {
     data_->Clear();
 }
 
+void ColumnIPv4::Reserve(size_t new_cap) {
+    data_->Reserve(new_cap);
+}
+
+void ColumnIPv4::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
+
 in_addr ColumnIPv4::At(size_t n) const {
     in_addr addr;
     addr.s_addr = ntohl(data_->At(n));
@@ -87,6 +95,10 @@ ColumnRef ColumnIPv4::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnIPv4>(data_->Slice(begin, len));
 }
 
+ColumnRef ColumnIPv4::CloneEmpty() const {
+    return std::make_shared<ColumnIPv4>(data_->CloneEmpty());
+}
+
 void ColumnIPv4::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnIPv4 &>(other);
     data_.swap(col.data_);
@@ -42,6 +42,14 @@ void ColumnIPv6::Clear() {
     data_->Clear();
 }
 
+void ColumnIPv6::Reserve(size_t new_cap) {
+    data_->Reserve(new_cap);
+}
+
+void ColumnIPv6::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
+
 std::string ColumnIPv6::AsString (size_t n) const {
     const auto& addr = this->At(n);
 
@@ -87,6 +95,10 @@ ColumnRef ColumnIPv6::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnIPv6>(data_->Slice(begin, len));
 }
 
+ColumnRef ColumnIPv6::CloneEmpty() const {
+    return std::make_shared<ColumnIPv6>(data_->CloneEmpty());
+}
+
 void ColumnIPv6::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnIPv6 &>(other);
     data_.swap(col.data_);
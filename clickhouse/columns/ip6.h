@@ -47,11 +47,21 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
+
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
     ItemView GetItem(size_t index) const override;
 
@@ -1,12 +1,13 @@
 #include "lowcardinality.h"
 
+#include "date.h"
 #include "string.h"
 #include "nullable.h"
+#include "../base/output.h"
 #include "../base/wire_format.h"
 
 #include <city.h>
 
-#include <functional>
 #include <string_view>
 #include <type_traits>
 
@@ -94,39 +95,233 @@ inline auto VisitIndexColumn(Vizitor && vizitor, ColumnType && col) {
     }
 }
 
-inline void AppendToDictionary(Column& dictionary, const ItemView & item) {
-    switch (dictionary.GetType().GetCode()) {
-        case Type::FixedString:
-            column_down_cast<ColumnFixedString>(dictionary).Append(item.get<std::string_view>());
-            return;
+// Narrowest type of index which is able to address all items of a dictionary of given size.
+IndexType indexTypeForDictionarySize(size_t dictionary_size) {
+    if (dictionary_size <= (1ull << 8))
+        return IndexType::UInt8;
+    if (dictionary_size <= (1ull << 16))
+        return IndexType::UInt16;
+    if (dictionary_size <= (1ull << 32))
+        return IndexType::UInt32;
+    return IndexType::UInt64;
+}
+
+template <typename T>
+ColumnRef convertIndexColumnTo(const Column & index_column) {
+    return VisitIndexColumn([](const auto & source) -> ColumnRef {
+        auto result = std::make_shared<ColumnVector<T>>();
+        const auto * source_data = source.GetData();
+        auto * values = result->Extend(source.Size());
+        for (size_t i = 0; i < source.Size(); ++i) {
+            values[i] = static_cast<T>(source_data[i]);
+        }
+        return result;
+    }, index_column);
+}
+
+// Copies all values of index column into a new index column of given type.
+ColumnRef convertIndexColumn(const Column & index_column, IndexType type) {
+    switch (type) {
+        case IndexType::UInt8:
+            return convertIndexColumnTo<uint8_t>(index_column);
+        case IndexType::UInt16:
+            return convertIndexColumnTo<uint16_t>(index_column);
+        case IndexType::UInt32:
+            return convertIndexColumnTo<uint32_t>(index_column);
+        case IndexType::UInt64:
+            return convertIndexColumnTo<uint64_t>(index_column);
+    }
+
+    throw ValidationError("Invalid LowCardinality index type value: " + std::to_string(static_cast<uint64_t>(type)));
+}
+
+// Dispatches to the typed column of any of the types which could be stored in a dictionary, except Nullable.
+template <typename Vizitor, typename ColumnType>
+inline auto VisitDictionaryColumn(Vizitor && vizitor, ColumnType && col) {
+    switch (col.Type()->GetCode()) {
+        case Type::Int8:
+            return vizitor(column_down_cast<ColumnInt8>(col));
+        case Type::Int16:
+            return vizitor(column_down_cast<ColumnInt16>(col));
+        case Type::Int32:
+            return vizitor(column_down_cast<ColumnInt32>(col));
+        case Type::Int64:
+            return vizitor(column_down_cast<ColumnInt64>(col));
+        case Type::UInt8:
+            return vizitor(column_down_cast<ColumnUInt8>(col));
+        case Type::UInt16:
+            return vizitor(column_down_cast<ColumnUInt16>(col));
+        case Type::UInt32:
+            return vizitor(column_down_cast<ColumnUInt32>(col));
+        case Type::UInt64:
+            return vizitor(column_down_cast<ColumnUInt64>(col));
+        case Type::Float32:
+            return vizitor(column_down_cast<ColumnFloat32>(col));
+        case Type::Float64:
+            return vizitor(column_down_cast<ColumnFloat64>(col));
+        case Type::Date:
+            return vizitor(column_down_cast<ColumnDate>(col));
+        case Type::DateTime:
+            return vizitor(column_down_cast<ColumnDateTime>(col));
         case Type::String:
-            column_down_cast<ColumnString>(dictionary).Append(item.get<std::string_view>());
-            return;
+            return vizitor(column_down_cast<ColumnString>(col));
+        case Type::FixedString:
+            return vizitor(column_down_cast<ColumnFixedString>(col));
         default:
-            throw ValidationError("Unexpected dictionary column type: " + dictionary.GetType().GetName());
+            throw ValidationError("Unexpected dictionary column type: " + col.GetType().GetName());
     }
 }
 
+template <typename T>
+inline void AppendItem(ColumnVector<T> & dictionary, const ItemView & item) {
+    dictionary.Append(item.get<T>());
+}
+
+inline void AppendItem(ColumnDate & dictionary, const ItemView & item) {
+    // Item holds number of days, as stored in the column.
+    dictionary.Append(static_cast<std::time_t>(item.get<uint16_t>()) * 86400);
+}
+
+inline void AppendItem(ColumnDateTime & dictionary, const ItemView & item) {
+    dictionary.Append(item.get<uint32_t>());
+}
+
+inline void AppendItem(ColumnString & dictionary, const ItemView & item) {
+    dictionary.Append(item.get<std::string_view>());
+}
+
+inline void AppendItem(ColumnFixedString & dictionary, const ItemView & item) {
+    dictionary.Append(item.get<std::string_view>());
+}
+
+// Enough zero bytes to view a default value of any fixed-size dictionary type.
+const char ZERO_BYTES[sizeof(uint64_t)] = {};
+
+template <typename ColumnType>
+inline ItemView DefaultItem(const ColumnType & dictionary) {
+    const auto code = dictionary.Type()->GetCode();
+    if constexpr (std::is_same_v<ColumnType, ColumnString> || std::is_same_v<ColumnType, ColumnFixedString>) {
+        return ItemView{code, std::string_view{}};
+    } else if constexpr (std::is_same_v<ColumnType, ColumnDate>) {
+        return ItemView{code, std::string_view{ZERO_BYTES, sizeof(uint16_t)}};
+    } else if constexpr (std::is_same_v<ColumnType, ColumnDateTime>) {
+        return ItemView{code, std::string_view{ZERO_BYTES, sizeof(uint32_t)}};
+    } else {
+        return ItemView{code, std::string_view{ZERO_BYTES, sizeof(typename ColumnType::ValueType)}};
+    }
+}
+
+inline void AppendToDictionary(Column& dictionary, const ItemView & item) {
+    if (dictionary.GetType().GetCode() == Type::Nullable) {
+        // NULL is stored in the dictionary as a default value of nested type.
+        auto & nullable = column_down_cast<ColumnNullable>(dictionary);
+        const bool is_null = item.type == Type::Void;
+        VisitDictionaryColumn([&item, is_null](auto & nested) {
+            AppendItem(nested, is_null ? DefaultItem(nested) : item);
+        }, *nullable.Nested());
+        nullable.Append(is_null);
+        return;
+    }
+
+    VisitDictionaryColumn([&item](auto & typed_dictionary) {
+        AppendItem(typed_dictionary, item);
+    }, dictionary);
+}
+
 // A special NULL-item, which is expected at pos(0) in dictionary,
-// note that we distinguish empty string from NULL-value.
-inline auto GetNullItemForDictionary(const ColumnRef dictionary) {
-    if (auto n = dictionary->As<ColumnNullable>()) {
+// note that we distinguish default value (i.e. empty string) from NULL-value.
+inline ItemView GetNullItemForDictionary(const ColumnRef dictionary) {
+    if (dictionary->GetType().GetCode() == Type::Nullable) {
         return ItemView{};
     } else {
-        return ItemView{dictionary->Type()->GetCode(), std::string_view{}};
+        return VisitDictionaryColumn([](const auto & typed_dictionary) {
+            return DefaultItem(typed_dictionary);
+        }, *dictionary);
     }
 }
 
+// Keys are serialized without null map, for Nullable dictionary that is the nested column.
+inline Column & GetKeysColumn(Column & dictionary) {
+    if (dictionary.GetType().GetCode() == Type::Nullable) {
+        return *column_down_cast<ColumnNullable>(dictionary).Nested();
+    }
+    return dictionary;
+}
+
+// Appends items of dictionary at positions from index to column of the same type as the dictionary.
+void GatherFromDictionary(Column & column, const Column & dictionary, const Column & index) {
+    if (dictionary.GetType().GetCode() == Type::Nullable) {
+        auto & nullable = column_down_cast<ColumnNullable>(column);
+        const auto & nullable_dictionary = column_down_cast<ColumnNullable>(dictionary);
+        GatherFromDictionary(*nullable.Nulls(), *nullable_dictionary.Nulls(), index);
+        GatherFromDictionary(*nullable.Nested(), *nullable_dictionary.Nested(), index);
+        return;
+    }
+
+    VisitDictionaryColumn([&column, &index](const auto & typed_dictionary) {
+        auto & typed_column = column_down_cast<std::decay_t<decltype(typed_dictionary)>>(column);
+        VisitIndexColumn([&typed_column, &typed_dictionary](const auto & typed_index) {
+            typed_column.Gather(typed_dictionary, typed_index);
+        }, index);
+    }, dictionary);
+}
+
 }
 
 namespace clickhouse {
+
+namespace details {
+
+void LowCardinalityUniqueItems::EraseLastInserted() {
+    // Items inserted before the last one never probed past its slot, since it was empty,
+    // so the slot is simply freed.
+    slots_[last_inserted_].position = EMPTY;
+    --size_;
+}
+
+void LowCardinalityUniqueItems::Reserve(size_t size) {
+    size_t capacity = std::max(slots_.size(), MIN_CAPACITY);
+    while (capacity < size * 2)
+        capacity *= 2;
+
+    if (capacity > slots_.size())
+        Rehash(capacity);
+}
+
+void LowCardinalityUniqueItems::Clear() {
+    std::fill(slots_.begin(), slots_.end(), Slot{0, EMPTY});
+    size_ = 0;
+}
+
+void LowCardinalityUniqueItems::Swap(LowCardinalityUniqueItems & other) noexcept {
+    slots_.swap(other.slots_);
+    std::swap(size_, other.size_);
+    std::swap(last_inserted_, other.last_inserted_);
+}
+
+void LowCardinalityUniqueItems::Rehash(size_t capacity) {
+    std::vector<Slot> slots(capacity, Slot{0, EMPTY});
+    const size_t mask = capacity - 1;
+
+    for (const auto & slot : slots_) {
+        if (slot.position == EMPTY)
+            continue;
+
+        size_t i = slot.hash & mask;
+        while (slots[i].position != EMPTY)
+            i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+
+    slots_.swap(slots);
+}
+
+}
+
 ColumnLowCardinality::ColumnLowCardinality(ColumnRef dictionary_column)
-    : Column(Type::CreateLowCardinality(dictionary_column->Type())),
-      dictionary_column_(dictionary_column->Slice(0, 0)), // safe way to get an column of the same type.
-      index_column_(std::make_shared<ColumnUInt32>())
+    : ColumnLowCardinality(Type::CreateLowCardinality(dictionary_column->Type()),
+            dictionary_column->Slice(0, 0)) // safe way to get an column of the same type.
 {
-    AppendNullItemToEmptyColumn();
-
     if (dictionary_column->Size() != 0) {
         // Add values, updating index_column_ and unique_items_map_.
 
@@ -140,6 +335,14 @@ ColumnLowCardinality::ColumnLowCardinality(ColumnRef dictionary_column)
     }
 }
 
+ColumnLowCardinality::ColumnLowCardinality(TypeRef type, ColumnRef empty_dictionary_column)
+    : Column(std::move(type)),
+      dictionary_column_(std::move(empty_dictionary_column)),
+      index_column_(createIndexColumn(IndexType::UInt8))
+{
+    AppendNullItemToEmptyColumn();
+}
+
 ColumnLowCardinality::~ColumnLowCardinality()
 {}
 
@@ -150,7 +353,12 @@ std::uint64_t ColumnLowCardinality::getDictionaryIndex(std::uint64_t item_index)
 }
 
 void ColumnLowCardinality::appendIndex(std::uint64_t item_index) {
-    // TODO (nemkov): handle case when index should go from UInt8 to UInt16, etc.
+    // Index column starts narrow and is widened once the dictionary outgrows it.
+    const auto required_type = indexTypeForDictionarySize(item_index + 1);
+    if (required_type > indexTypeFromIndexColumn(*index_column_)) {
+        index_column_ = convertIndexColumn(*index_column_, required_type);
+    }
+
     VisitIndexColumn([item_index](auto & arg) {
         arg.Append(item_index);
     }, *index_column_);
@@ -162,17 +370,13 @@ void ColumnLowCardinality::removeLastIndex() {
     }, *index_column_);
 }
 
-details::LowCardinalityHashKey ColumnLowCardinality::computeHashKey(const ItemView & item) {
-    static const auto hasher = std::hash<ItemView::DataType>{};
+std::uint64_t ColumnLowCardinality::computeHashKey(const ItemView & item) {
     if (item.type == Type::Void) {
         // to distinguish NULL of ColumnNullable and empty string.
-        return {0u, 0u};
+        return 0u;
     }
 
-    const auto hash1 = hasher(item.data);
-    const auto hash2 = CityHash64(item.data.data(), item.data.size());
-
-    return details::LowCardinalityHashKey{hash1, hash2};
+    return CityHash64(item.data.data(), item.data.size());
 }
 
 ColumnRef ColumnLowCardinality::GetDictionary() {
@@ -184,21 +388,96 @@ void ColumnLowCardinality::Append(ColumnRef col) {
     if (!c || !dictionary_column_->Type()->IsEqual(c->dictionary_column_->Type()))
         return;
 
-    for (size_t i = 0; i < c->Size(); ++i) {
-        AppendUnsafe(c->GetItem(i));
+    // Each item of the other dictionary is looked up once, rows are appended through the remap of positions.
+    const size_t rows = c->Size();
+    const size_t dictionary_size = c->dictionary_column_->Size();
+    std::vector<std::uint64_t> remap(dictionary_size);
+    std::vector<bool> remapped(dictionary_size, false);
+
+    for (size_t i = 0; i < rows; ++i) {
+        const auto position = c->getDictionaryIndex(i);
+        if (!remapped[position]) {
+            AppendUnsafe(c->dictionary_column_->GetItem(position));
+            remap[position] = getDictionaryIndex(Size() - 1);
+            remapped[position] = true;
+        } else {
+            appendIndex(remap[position]);
+        }
     }
 }
 
 namespace {
 
-auto Load(ColumnRef new_dictionary_column, InputStream& input, size_t rows) {
+// Reads keys into \p keys column, which should be empty.
+// Keys of Nullable dictionary have NULL at position 0, if \p has_null_item.
+void LoadKeysInto(Column & keys, InputStream& input, const char * what, bool has_null_item) {
+    if (keys.GetType().GetCode() == Type::Nullable) {
+        auto & nullable_keys = column_down_cast<ColumnNullable>(keys);
+        auto & nested_keys = *nullable_keys.Nested();
+        LoadKeysInto(nested_keys, input, what, has_null_item);
+
+        auto & nulls = column_down_cast<ColumnUInt8>(*nullable_keys.Nulls());
+        nulls.Clear();
+        nulls.Extend(nested_keys.Size());
+        if (has_null_item && nested_keys.Size() != 0)
+            nulls.GetWritableData()[0] = 1;
+        return;
+    }
+
+    uint64_t number_of_keys;
+    if (!WireFormat::ReadFixed(input, &number_of_keys))
+        throw ProtocolError(std::string("Failed to read number of rows in ") + what + ".");
+
+    if (!keys.Load(&input, number_of_keys))
+        throw ProtocolError(std::string("Failed to read values of ") + what + ".");
+}
+
+// Position of keys read at once within the dictionary they are appended to.
+struct KeysPosition {
+    size_t offset = 0;
+    // Number of keys as read, the index refers to them.
+    size_t size = 0;
+    // NULL at position 0 of the keys is not appended, since it is at position 0 of the dictionary already.
+    bool null_item_merged = false;
+
+    uint64_t DictionaryIndex(uint64_t key_index) const {
+        if (null_item_merged)
+            return key_index == 0 ? 0 : offset + key_index - 1;
+        return offset + key_index;
+    }
+};
+
+// Reads keys and appends them to the dictionary, loading directly into it when it is empty.
+KeysPosition LoadKeys(Column & dictionary, InputStream& input, const char * what, bool has_null_item) {
+    KeysPosition position;
+    position.offset = dictionary.Size();
+    if (dictionary.Size() == 0) {
+        LoadKeysInto(dictionary, input, what, has_null_item);
+        position.size = dictionary.Size();
+    } else {
+        auto keys = dictionary.Slice(0, 0);
+        LoadKeysInto(*keys, input, what, has_null_item);
+        position.size = keys->Size();
+        // Only position 0 of Nullable dictionary is NULL, Save() and Slice() rely on that.
+        if (has_null_item && keys->Size() != 0 && dictionary.GetType().GetCode() == Type::Nullable) {
+            keys = keys->Slice(1, keys->Size() - 1);
+            position.null_item_merged = true;
+        }
+        dictionary.Append(keys);
+    }
+    return position;
+}
+
+// Loads keys into empty \p dictionary and returns index referring to it,
+// which is \p index_column if its type matches the one of the data.
+ColumnRef Load(Column & dictionary, ColumnRef index_column, InputStream& input, size_t rows) {
     // This code tries to follow original implementation of ClickHouse's LowCardinality serialization with
     // NativeBlockOutputStream::writeData() for DataTypeLowCardinality
-    // (see corresponding serializeBinaryBulkStateSuffix, serializeBinaryBulkStatePrefix, and serializeBinaryBulkWithMultipleStreams),
-    // but with certain simplifications: no shared dictionaries, no on-the-fly dictionary updates.
+    // (see corresponding serializeBinaryBulkStateSuffix, serializeBinaryBulkStatePrefix, and deserializeBinaryBulkWithMultipleStreams).
     //
-    // As for now those features are not used in client-server protocol and minimal implementation suffices,
-    // however some day they may.
+    // Rows could be split into granules, each of them refers to the global dictionary (sent again if updated),
+    // to keys of its own (additional keys) or to both. All the keys are collected into a single dictionary.
+    // Within the native protocol the state is not shared between blocks, since the server resets it for each block.
 
     // prefix
     uint64_t key_version;
@@ -209,57 +488,105 @@ auto Load(ColumnRef new_dictionary_column, InputStream& input, size_t rows) {
         throw ProtocolError("Invalid key serialization version value.");
 
     // body
-    uint64_t index_serialization_type;
-    if (!WireFormat::ReadFixed(input, &index_serialization_type))
-        throw ProtocolError("Failed to read index serializaton type.");
-
-    auto new_index_column = createIndexColumn(static_cast<IndexType>(index_serialization_type & IndexTypeMask));
-    if (index_serialization_type & IndexFlag::NeedGlobalDictionaryBit)
-        throw UnimplementedError("Global dictionary is not supported.");
-
-    if ((index_serialization_type & IndexFlag::HasAdditionalKeysBit) == 0)
-        throw ValidationError("HasAdditionalKeysBit is missing.");
-
-    uint64_t number_of_keys;
-    if (!WireFormat::ReadFixed(input, &number_of_keys))
-        throw ProtocolError("Failed to read number of rows in dictionary column.");
-
-    if (!new_dictionary_column->Load(&input, number_of_keys))
-        throw ProtocolError("Failed to read values of dictionary column.");
+    ColumnRef new_index_column;
+    // Positions in dictionary, if there are several granules or the global dictionary.
+    std::vector<uint64_t> remapped_indexes;
+    KeysPosition global_dictionary;
+    bool has_global_dictionary = false;
+    size_t rows_read = 0;
+
+    do {
+        uint64_t index_serialization_type;
+        if (!WireFormat::ReadFixed(input, &index_serialization_type))
+            throw ProtocolError("Failed to read index serializaton type.");
+
+        const bool need_global_dictionary = index_serialization_type & IndexFlag::NeedGlobalDictionaryBit;
+        const bool has_additional_keys = index_serialization_type & IndexFlag::HasAdditionalKeysBit;
+
+        if (!need_global_dictionary && !has_additional_keys)
+            throw ValidationError("HasAdditionalKeysBit is missing.");
+
+        if (need_global_dictionary && (!has_global_dictionary || (index_serialization_type & IndexFlag::NeedUpdateDictionary))) {
+            global_dictionary = LoadKeys(dictionary, input, "global dictionary", true);
+            has_global_dictionary = true;
+        }
 
-    uint64_t number_of_rows;
-    if (!WireFormat::ReadFixed(input, &number_of_rows))
-        throw ProtocolError("Failed to read number of rows in index column.");
+        KeysPosition additional_keys;
+        additional_keys.offset = dictionary.Size();
+        if (has_additional_keys) {
+            // NULL is referred by position 0 of the global dictionary, if there is one.
+            additional_keys = LoadKeys(dictionary, input, "dictionary column", !need_global_dictionary);
+        }
 
-    if (number_of_rows != rows)
-        throw AssertionError("LowCardinality column must be read in full.");
+        uint64_t number_of_rows;
+        if (!WireFormat::ReadFixed(input, &number_of_rows))
+            throw ProtocolError("Failed to read number of rows in index column.");
+
+        if (number_of_rows > rows - rows_read)
+            throw AssertionError("LowCardinality column must be read in full.");
+
+        const bool is_only_granule = rows_read == 0 && number_of_rows == rows && !need_global_dictionary;
+        const auto index_type = static_cast<IndexType>(index_serialization_type & IndexTypeMask);
+        auto granule_index_column = is_only_granule && index_type == indexTypeFromIndexColumn(*index_column)
+                ? index_column
+                : createIndexColumn(index_type);
+        if (!granule_index_column->Load(&input, number_of_rows))
+            throw ProtocolError("Failed to read values of index column.");
+
+        if (is_only_granule) {
+            // The only granule, with keys of its own: the index refers to the dictionary as is.
+            const size_t dictionary_size = dictionary.Size();
+            VisitIndexColumn([&](const auto & granule_index) {
+                for (size_t i = 0; i < granule_index.Size(); ++i) {
+                    if (granule_index[i] >= dictionary_size)
+                        throw ValidationError("LowCardinality index is out of dictionary.");
+                }
+            }, *granule_index_column);
+            new_index_column = granule_index_column;
+        } else {
+            const size_t dictionary_size = dictionary.Size();
+            VisitIndexColumn([&](const auto & granule_index) {
+                for (size_t i = 0; i < granule_index.Size(); ++i) {
+                    uint64_t index = granule_index[i];
+                    if (need_global_dictionary && (!has_additional_keys || index < global_dictionary.size))
+                        index = global_dictionary.DictionaryIndex(index);
+                    else
+                        index = additional_keys.DictionaryIndex(index - (need_global_dictionary ? global_dictionary.size : 0));
+
+                    if (index >= dictionary_size)
+                        throw ValidationError("LowCardinality index is out of dictionary.");
+                    remapped_indexes.push_back(index);
+                }
+            }, *granule_index_column);
+        }
 
-    new_index_column->Load(&input, number_of_rows);
+        rows_read += number_of_rows;
+    } while (rows_read < rows);
 
-    ColumnLowCardinality::UniqueItems new_unique_items_map;
-    for (size_t i = 0; i < new_dictionary_column->Size(); ++i) {
-        const auto key = ColumnLowCardinality::computeHashKey(new_dictionary_column->GetItem(i));
-        new_unique_items_map.emplace(key, i);
+    if (!new_index_column) {
+        new_index_column = convertIndexColumn(ColumnUInt64(std::move(remapped_indexes)),
+                indexTypeForDictionarySize(dictionary.Size()));
     }
 
     // suffix
     // NOP
 
-    return std::make_tuple(new_dictionary_column, new_index_column, new_unique_items_map);
+    return new_index_column;
 }
 
 }
 
 bool ColumnLowCardinality::Load(InputStream* input, size_t rows) {
-    try {
-        auto [new_dictionary, new_index, new_unique_items_map] = ::Load(dictionary_column_->Slice(0, 0), *input, rows);
-
-        dictionary_column_->Swap(*new_dictionary);
-        index_column_.swap(new_index);
-        unique_items_map_.swap(new_unique_items_map);
+    // Dictionary and index are loaded in place, reusing memory allocated for them.
+    dictionary_column_->Clear();
+    unique_items_map_.Clear();
+    unique_items_map_valid_ = false;
 
+    try {
+        index_column_ = ::Load(*dictionary_column_, index_column_, *input, rows);
         return true;
     } catch (...) {
+        Clear();
         return false;
     }
 }
@@ -270,29 +597,55 @@ void ColumnLowCardinality::Save(OutputStream* output) {
     WireFormat::WriteFixed(*output, version);
 
     // body
-    const uint64_t index_serialization_type = indexTypeFromIndexColumn(*index_column_) | IndexFlag::HasAdditionalKeysBit;
+    // Index column could be wider than necessary, i.e. as received from the server or after Clear().
+    // It is narrowed into a temporary column then, since the column may be saved from several threads at once.
+    const auto index_type = indexTypeForDictionarySize(dictionary_column_->Size());
+    ColumnRef narrowed_index_column;
+    if (index_type != indexTypeFromIndexColumn(*index_column_)) {
+        narrowed_index_column = convertIndexColumn(*index_column_, index_type);
+    }
+
+    const uint64_t index_serialization_type = index_type | IndexFlag::HasAdditionalKeysBit;
     WireFormat::WriteFixed(*output, index_serialization_type);
 
     const uint64_t number_of_keys = dictionary_column_->Size();
     WireFormat::WriteFixed(*output, number_of_keys);
-    dictionary_column_->Save(output);
+    GetKeysColumn(*dictionary_column_).Save(output);
 
     const uint64_t number_of_rows = index_column_->Size();
     WireFormat::WriteFixed(*output, number_of_rows);
-    index_column_->Save(output);
+    if (narrowed_index_column) {
+        // Data of the temporary column is copied, since it is gone before the output is flushed.
+        CopyingOutput copying_output(output);
+        narrowed_index_column->Save(&copying_output);
+    } else {
+        index_column_->Save(output);
+    }
 
     // suffix
     // NOP
 }
 
 void ColumnLowCardinality::Clear() {
+    // Index keeps its type along with allocated memory, it is narrowed on Save() anyway.
     index_column_->Clear();
     dictionary_column_->Clear();
-    unique_items_map_.clear();
+    unique_items_map_.Clear();
+    unique_items_map_valid_ = true;
 
     AppendNullItemToEmptyColumn();
 }
 
+void ColumnLowCardinality::Reserve(size_t new_cap) {
+    // Size of dictionary is not known.
+    index_column_->Reserve(new_cap);
+}
+
+void ColumnLowCardinality::ShrinkToFit() {
+    dictionary_column_->ShrinkToFit();
+    index_column_->ShrinkToFit();
+}
+
 size_t ColumnLowCardinality::Size() const {
     return index_column_->Size();
 }
@@ -303,12 +656,38 @@ ColumnRef ColumnLowCardinality::Slice(size_t begin, size_t len) const {
 
     auto result = std::make_shared<ColumnLowCardinality>(dictionary_column_->Slice(0, 0));
 
-    for (size_t i = begin; i < begin + len; ++i)
-        result->AppendUnsafe(this->GetItem(i));
+    // Only keys referenced by the rows are copied, in order of first reference, after the null-item.
+    constexpr auto NOT_REFERENCED = static_cast<std::uint64_t>(-1);
+    std::vector<std::uint64_t> remap(dictionary_column_->Size(), NOT_REFERENCED);
+    std::vector<std::uint64_t> referenced_keys;
+    std::vector<std::uint64_t> new_index(len);
+    remap[0] = 0;
+
+    VisitIndexColumn([&](const auto & index) {
+        const auto * index_data = index.GetData() + begin;
+        for (size_t i = 0; i < len; ++i) {
+            auto & position = remap[index_data[i]];
+            if (position == NOT_REFERENCED) {
+                position = referenced_keys.size() + 1;
+                referenced_keys.push_back(index_data[i]);
+            }
+            new_index[i] = position;
+        }
+    }, *index_column_);
+
+    GatherFromDictionary(*result->dictionary_column_, *dictionary_column_, ColumnUInt64(std::move(referenced_keys)));
+    result->index_column_ = convertIndexColumn(ColumnUInt64(std::move(new_index)),
+            indexTypeForDictionarySize(result->dictionary_column_->Size()));
+    result->unique_items_map_.Clear();
+    result->unique_items_map_valid_ = false;
 
     return result;
 }
 
+ColumnRef ColumnLowCardinality::CloneEmpty() const {
+    return ColumnRef{new ColumnLowCardinality(type_, dictionary_column_->CloneEmpty())};
+}
+
 void ColumnLowCardinality::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnLowCardinality &>(other);
     if (!dictionary_column_->Type()->IsEqual(col.dictionary_column_->Type()))
@@ -320,7 +699,15 @@ void ColumnLowCardinality::Swap(Column& other) {
     dictionary_column_->Swap(*col.dictionary_column_);
 
     index_column_.swap(col.index_column_);
-    unique_items_map_.swap(col.unique_items_map_);
+    unique_items_map_.Swap(col.unique_items_map_);
+    std::swap(unique_items_map_valid_, col.unique_items_map_valid_);
+}
+
+void ColumnLowCardinality::AppendValuesTo(Column & column) const {
+    if (!dictionary_column_->Type()->IsEqual(column.Type()))
+        throw ValidationError("Can't append values of " + GetType().GetName() + " to " + column.GetType().GetName());
+
+    GatherFromDictionary(column, *dictionary_column_, *index_column_);
 }
 
 ItemView ColumnLowCardinality::GetItem(size_t index) const {
@@ -329,10 +716,33 @@ ItemView ColumnLowCardinality::GetItem(size_t index) const {
 
 // No checks regarding value type or validity of value is made.
 void ColumnLowCardinality::AppendUnsafe(const ItemView & value) {
-    const auto key = computeHashKey(value);
+    AppendUnsafe(value, computeHashKey(value));
+}
+
+void ColumnLowCardinality::AppendUnsafe(const std::vector<ItemView> & items) {
+    std::vector<std::uint64_t> hashes(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        hashes[i] = computeHashKey(items[i]);
+    }
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        AppendUnsafe(items[i], hashes[i]);
+    }
+}
+
+void ColumnLowCardinality::AppendUnsafe(const ItemView & value, std::uint64_t hash) {
+    if (!unique_items_map_valid_)
+        BuildUniqueItemsMap();
+
     const auto initial_index_size = index_column_->Size();
     // If the value is unique, then we are going to append it to a dictionary, hence new index is Size().
-    auto [iterator, is_new_item] = unique_items_map_.try_emplace(key, dictionary_column_->Size());
+    const auto [position, is_new_item] = unique_items_map_.FindOrInsert(hash, dictionary_column_->Size(),
+        [this, &value](size_t pos) {
+            // Type of an item could differ from that of a value only by the way it's viewed, i.e. UInt16 for Date,
+            // except for the NULL-item.
+            const auto item = dictionary_column_->GetItem(pos);
+            return item.data == value.data && (item.type == Type::Void) == (value.type == Type::Void);
+        });
     try {
         // Order is important, adding to dictionary last, since it is much (MUCH!!!!) harder
         // to remove item from dictionary column than from index column
@@ -340,7 +750,7 @@ void ColumnLowCardinality::AppendUnsafe(const ItemView & value) {
         // Hence in catch-block we assume that dictionary wasn't modified on exception
         // and there is nothing to rollback.
 
-        appendIndex(iterator->second);
+        appendIndex(position);
         if (is_new_item) {
             AppendToDictionary(*dictionary_column_, value);
         }
@@ -349,23 +759,35 @@ void ColumnLowCardinality::AppendUnsafe(const ItemView & value) {
         if (index_column_->Size() != initial_index_size)
             removeLastIndex();
         if (is_new_item)
-            unique_items_map_.erase(iterator);
+            unique_items_map_.EraseLastInserted();
 
         throw;
     }
 }
 
+void ColumnLowCardinality::BuildUniqueItemsMap() {
+    unique_items_map_.Clear();
+    unique_items_map_.Reserve(dictionary_column_->Size());
+    for (size_t i = 0; i < dictionary_column_->Size(); ++i) {
+        // Items of a dictionary received from the server are unique, except if it consists of several ones,
+        // in which case the first of equal items is found.
+        unique_items_map_.FindOrInsert(computeHashKey(dictionary_column_->GetItem(i)), i, [](size_t) { return false; });
+    }
+
+    unique_items_map_valid_ = true;
+}
+
 void ColumnLowCardinality::AppendNullItemToEmptyColumn()
 {
     // INVARIANT: Empty LC column has an (invisible) null-item at pos 0, which MUST be present in
     // unique_items_map_ in order to reuse dictionary posistion on subsequent Append()-s.
 
     // Should be only performed on empty LC column.
-    assert(dictionary_column_->Size() == 0 && unique_items_map_.empty());
+    assert(dictionary_column_->Size() == 0 && unique_items_map_.Size() == 0);
 
     const auto null_item = GetNullItemForDictionary(dictionary_column_);
     AppendToDictionary(*dictionary_column_, null_item);
-    unique_items_map_.emplace(computeHashKey(null_item), 0);
+    unique_items_map_.FindOrInsert(computeHashKey(null_item), 0, [](size_t) { return false; });
 }
 
 size_t ColumnLowCardinality::GetDictionarySize() const {
@@ -1,12 +1,14 @@
 #pragma once
 
 #include "column.h"
+#include "date.h"
 #include "numeric.h"
 
-#include <functional>
+#include <algorithm>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace clickhouse {
 
@@ -15,26 +17,70 @@ class ColumnLowCardinalityT;
 
 namespace details {
 
-/** LowCardinalityHashKey used as key in unique items hashmap to abstract away key value
- * (type of which depends on dictionary column) and to reduce likelehood of collisions.
+/** Positions of unique items in the dictionary of LowCardinality column, looked up by hash of an item.
  *
- * In order to dramatically reduce collision rate, we use 2 different hashes from 2 different hash functions.
- * First hash is used in hashtable (to calculate item position).
- * Second one is used as part of key value and accessed via `operator==()` upon collision resolution/detection.
+ * Flat open-addressing table, which stores a hash of each item along with its position in the dictionary.
+ * Items with equal hashes are compared against the dictionary, so hash collisions never merge distinct items.
  */
-using LowCardinalityHashKey = std::pair<std::uint64_t, std::uint64_t>;
+class LowCardinalityUniqueItems {
+public:
+    /// Returns position of an item with \p hash, for which \p equals(position) holds,
+    /// or inserts \p position for it. Second value is true if \p position was inserted.
+    template <typename Equals>
+    std::pair<size_t, bool> FindOrInsert(std::uint64_t hash, size_t position, Equals && equals) {
+        if ((size_ + 1) * 2 > slots_.size())
+            Rehash(std::max<size_t>(slots_.size() * 2, MIN_CAPACITY));
+
+        const size_t mask = slots_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot & slot = slots_[i];
+            if (slot.position == EMPTY) {
+                slot = Slot{hash, position};
+                ++size_;
+                last_inserted_ = i;
+                return {position, true};
+            }
+            if (slot.hash == hash && equals(slot.position))
+                return {slot.position, false};
+        }
+    }
+
+    /// Removes the item inserted by the last FindOrInsert().
+    void EraseLastInserted();
 
-struct LowCardinalityHashKeyHash {
-    inline std::size_t operator()(const LowCardinalityHashKey &hash_key) const noexcept {
-        return hash_key.first;
+    /// Makes room for \p size items without rehashing.
+    void Reserve(size_t size);
+
+    void Clear();
+    void Swap(LowCardinalityUniqueItems & other) noexcept;
+
+    inline size_t Size() const {
+        return size_;
     }
+
+private:
+    void Rehash(size_t capacity);
+
+private:
+    static constexpr size_t EMPTY = static_cast<size_t>(-1);
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    struct Slot {
+        std::uint64_t hash;
+        size_t position;
+    };
+
+    /// Number of slots is a power of two, at most half of them are occupied.
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    size_t last_inserted_ = 0;
 };
 
 }
 
 class ColumnLowCardinality : public Column {
 public:
-    using UniqueItems = std::unordered_map<details::LowCardinalityHashKey, size_t /*dictionary index*/, details::LowCardinalityHashKeyHash>;
+    using UniqueItems = details::LowCardinalityUniqueItems;
 
     template <typename T>
     friend class ColumnLowCardinalityT;
@@ -45,6 +91,8 @@ private:
     ColumnRef dictionary_column_;
     ColumnRef index_column_;
     UniqueItems unique_items_map_;
+    /// unique_items_map_ is built on the first append after Load(), since loaded columns are mostly only read.
+    bool unique_items_map_valid_ = true;
 
 public:
     // c-tor makes a deep copy of the dictionary_column.
@@ -63,31 +111,50 @@ public:
     /// Clear column data.
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of current column, with compacted dictionary
     ColumnRef Slice(size_t begin, size_t len) const override;
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
     ItemView GetItem(size_t index) const override;
 
     size_t GetDictionarySize() const;
     TypeRef GetNestedType() const;
 
+    /// Appends values of all rows to \p column, which should be of the same type as the dictionary.
+    void AppendValuesTo(Column & column) const;
+
 protected:
+    /// Makes an empty column of given type around an empty dictionary column, taking ownership of it.
+    ColumnLowCardinality(TypeRef type, ColumnRef empty_dictionary_column);
+
     std::uint64_t getDictionaryIndex(std::uint64_t item_index) const;
     void appendIndex(std::uint64_t item_index);
     void removeLastIndex();
 
     ColumnRef GetDictionary();
     void AppendUnsafe(const ItemView &);
+    /// Hashes all the items first, then appends them one by one.
+    void AppendUnsafe(const std::vector<ItemView> & items);
 
 private:
     void AppendNullItemToEmptyColumn();
+    void AppendUnsafe(const ItemView &, std::uint64_t hash);
+    void BuildUniqueItemsMap();
 
 public:
-    static details::LowCardinalityHashKey computeHashKey(const ItemView &);
+    static std::uint64_t computeHashKey(const ItemView &);
 };
 
 /** Type-aware wrapper that provides simple convenience interface for accessing/appending individual items.
@@ -115,6 +182,14 @@ public:
           type_(typed_dictionary_.Type()->GetCode())
     {}
 
+private:
+    ColumnLowCardinalityT(TypeRef type, std::shared_ptr<DictionaryColumnType> empty_dictionary_col)
+        : ColumnLowCardinality(std::move(type), std::move(empty_dictionary_col)),
+          typed_dictionary_(dynamic_cast<DictionaryColumnType &>(*GetDictionary())),
+          type_(typed_dictionary_.Type()->GetCode())
+    {}
+
+public:
     /// Extended interface to simplify reading/adding individual items.
 
     /// Returns element at given row number.
@@ -127,17 +202,48 @@ public:
         return typed_dictionary_[getDictionaryIndex(n)];
     }
 
+    /// Makes slice of current column, with compacted dictionary
+    ColumnRef Slice(size_t begin, size_t len) const override {
+        auto result = std::make_shared<ColumnLowCardinalityT>(typed_dictionary_.Slice(0, 0)->template As<DictionaryColumnType>());
+        result->Swap(*ColumnLowCardinality::Slice(begin, len));
+        return result;
+    }
+
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override {
+        return ColumnRef{new ColumnLowCardinalityT(Column::type_, typed_dictionary_.CloneEmpty()->template As<DictionaryColumnType>())};
+    }
+
     // so the non-virtual Append below doesn't shadow Append() from base class when compiled with older compilers.
     using ColumnLowCardinality::Append;
 
     inline void Append(const ValueType & value) {
-        AppendUnsafe(ItemView{type_, value});
+        // Dates are viewed as stored in the dictionary column.
+        if constexpr (std::is_same_v<DictionaryColumnType, ColumnDate>) {
+            AppendUnsafe(ItemView{type_, static_cast<uint16_t>(value / std::time_t(86400))});
+        } else if constexpr (std::is_same_v<DictionaryColumnType, ColumnDateTime>) {
+            AppendUnsafe(ItemView{type_, static_cast<uint32_t>(value)});
+        } else {
+            AppendUnsafe(ItemView{type_, value});
+        }
     }
 
     template <typename T>
     inline void AppendMany(const T& container) {
-        for (const auto & item : container) {
-            Append(item);
+        using ItemType = std::decay_t<decltype(*std::begin(container))>;
+        constexpr bool is_viewable = !std::is_same_v<DictionaryColumnType, ColumnDate>
+                && !std::is_same_v<DictionaryColumnType, ColumnDateTime>;
+        if constexpr (is_viewable && (std::is_same_v<ItemType, ValueType> || std::is_same_v<ItemType, std::string>)) {
+            // Views on items of the container stay valid while they are appended.
+            std::vector<ItemView> items;
+            for (const auto & item : container) {
+                items.emplace_back(type_, item);
+            }
+            AppendUnsafe(items);
+        } else {
+            for (const auto & item : container) {
+                Append(item);
+            }
         }
     }
 };
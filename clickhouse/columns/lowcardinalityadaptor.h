@@ -2,12 +2,10 @@
 
 #include "column.h"
 #include "lowcardinality.h"
-
-#include <cassert>
+#include "../base/output.h"
 
 namespace clickhouse {
 
-class OutputStream;
 class CodedInputStream;
 
 /** Adapts any ColumnType to be serialized\deserialized as LowCardinality,
@@ -29,26 +27,33 @@ public:
 
     /// Loads column data from input stream.
     bool Load(InputStream* input, size_t rows) override {
-        auto new_data_column = this->Slice(0, 0)->template As<AdaptedColumnType>();
-
-        ColumnLowCardinalityT<AdaptedColumnType> low_cardinality_col(new_data_column);
+        ColumnLowCardinality low_cardinality_col(this->AdaptedColumnType::CloneEmpty());
         if (!low_cardinality_col.Load(input, rows))
             return false;
 
-        // It safe to reuse `flat_data_column` later since ColumnLowCardinalityT makes a deep copy, but still check just in case.
-        assert(new_data_column->Size() == 0);
-
-        for (size_t i = 0; i < low_cardinality_col.Size(); ++i)
-            new_data_column->Append(low_cardinality_col[i]);
-
-        this->Swap(*new_data_column);
+        // Values are gathered into this column, reusing memory allocated for it.
+        this->Clear();
+        low_cardinality_col.AppendValuesTo(*this);
         return true;
     }
 
     /// Saves column data to output stream.
     void Save(OutputStream* output) override {
-        ColumnLowCardinalityT<AdaptedColumnType>(this->template As<AdaptedColumnType>()).Save(output);
+        // Data of the temporary column is copied, since it is gone before the output is flushed.
+        CopyingOutput copying_output(output);
+        ColumnLowCardinality(this->template As<AdaptedColumnType>()).Save(&copying_output);
     }
+
+    /// Makes an empty column of the same type, serialized as LowCardinality too.
+    ColumnRef CloneEmpty() const override {
+        auto empty = AdaptedColumnType::CloneEmpty();
+        return ColumnRef{new LowCardinalitySerializationAdaptor(std::move(static_cast<AdaptedColumnType&>(*empty)))};
+    }
+
+private:
+    explicit LowCardinalitySerializationAdaptor(AdaptedColumnType&& column)
+        : AdaptedColumnType(std::move(column))
+    {}
 };
 
 }
@@ -40,6 +40,11 @@ public:
 		return std::make_shared<ColumnNothing>(len);
 	}
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override {
+		return std::make_shared<ColumnNothing>();
+	}
+
     ItemView GetItem(size_t /*index*/) const override { return ItemView{}; }
 
 public:
@@ -53,7 +58,7 @@ public:
     /// Loads column data from input stream.
     bool Load(InputStream* input, size_t rows) override {
 		input->Skip(rows);
-		size_ += rows;
+		size_ = rows;
 		return true;
 	}
 
@@ -65,6 +70,10 @@ public:
     /// Clear column data .
     void Clear() override { size_ = 0; }
 
+    void Reserve(size_t) override {}
+
+    void ShrinkToFit() override {}
+
     /// Returns count of rows in the column.
     size_t Size() const override { return size_; }
 
@@ -15,6 +15,13 @@ ColumnNullable::ColumnNullable(ColumnRef nested, ColumnRef nulls)
     }
 }
 
+ColumnNullable::ColumnNullable(TypeRef type, ColumnRef nested, ColumnRef nulls)
+    : Column(std::move(type))
+    , nested_(std::move(nested))
+    , nulls_(nulls->As<ColumnUInt8>())
+{
+}
+
 void ColumnNullable::Append(bool isnull)
 {
     nulls_->Append(isnull ? 1 : 0);
@@ -50,6 +57,16 @@ void ColumnNullable::Clear() {
     nulls_->Clear();
 }
 
+void ColumnNullable::Reserve(size_t new_cap) {
+    nested_->Reserve(new_cap);
+    nulls_->Reserve(new_cap);
+}
+
+void ColumnNullable::ShrinkToFit() {
+    nested_->ShrinkToFit();
+    nulls_->ShrinkToFit();
+}
+
 bool ColumnNullable::Load(InputStream* input, size_t rows) {
     if (!nulls_->Load(input, rows)) {
         return false;
@@ -74,6 +91,10 @@ ColumnRef ColumnNullable::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnNullable>(nested_->Slice(begin, len), nulls_->Slice(begin, len));
 }
 
+ColumnRef ColumnNullable::CloneEmpty() const {
+    return ColumnRef{new ColumnNullable(type_, nested_->CloneEmpty(), nulls_->CloneEmpty())};
+}
+
 void ColumnNullable::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnNullable &>(other);
     if (!nested_->Type()->IsEqual(col.nested_->Type()))
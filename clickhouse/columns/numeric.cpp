@@ -30,6 +30,28 @@ void ColumnVector<T>::Append(const T& value) {
     data_.push_back(value);
 }
 
+template <typename T>
+void ColumnVector<T>::AppendMany(const T* values, size_t count) {
+    data_.insert(data_.end(), values, values + count);
+}
+
+template <typename T>
+T* ColumnVector<T>::Extend(size_t count) {
+    const auto old_size = data_.size();
+    data_.resize(old_size + count);
+    return data_.data() + old_size;
+}
+
+template <typename T>
+const T* ColumnVector<T>::GetData() const {
+    return data_.data();
+}
+
+template <typename T>
+T* ColumnVector<T>::GetWritableData() {
+    return data_.data();
+}
+
 template <typename T>
 void ColumnVector<T>::Erase(size_t pos, size_t count) {
     const auto begin = std::min(pos, data_.size());
@@ -43,6 +65,16 @@ void ColumnVector<T>::Clear() {
     data_.clear();
 }
 
+template <typename T>
+void ColumnVector<T>::Reserve(size_t new_cap) {
+    data_.reserve(new_cap);
+}
+
+template <typename T>
+void ColumnVector<T>::ShrinkToFit() {
+    data_.shrink_to_fit();
+}
+
 template <typename T>
 const T& ColumnVector<T>::At(size_t n) const {
     return data_.at(n);
@@ -69,7 +101,7 @@ bool ColumnVector<T>::Load(InputStream* input, size_t rows) {
 
 template <typename T>
 void ColumnVector<T>::Save(OutputStream* output) {
-    WireFormat::WriteBytes(*output, data_.data(), data_.size() * sizeof(T));
+    WireFormat::WriteBytesRef(*output, data_.data(), data_.size() * sizeof(T));
 }
 
 template <typename T>
@@ -82,6 +114,11 @@ ColumnRef ColumnVector<T>::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnVector<T>>(SliceVector(data_, begin, len));
 }
 
+template <typename T>
+ColumnRef ColumnVector<T>::CloneEmpty() const {
+    return std::make_shared<ColumnVector<T>>();
+}
+
 template <typename T>
 void ColumnVector<T>::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnVector<T> &>(other);
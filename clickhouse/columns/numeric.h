@@ -22,6 +22,21 @@ public:
     /// Appends one element to the end of column.
     void Append(const T& value);
 
+    /// Appends \p count elements from \p values to the end of column.
+    void AppendMany(const T* values, size_t count);
+
+    /// Appends \p count zero-initialized elements to the end of column
+    /// and returns pointer to the first of them, to be filled in place.
+    /// The pointer is valid until the column is modified.
+    T* Extend(size_t count);
+
+    /// Returns pointer to elements of the column, which is valid until the column is modified.
+    const T* GetData() const;
+
+    /// Returns pointer to elements of the column to be changed in place,
+    /// which is valid until the column is modified otherwise.
+    T* GetWritableData();
+
     /// Returns element at given row number.
     const T& At(size_t n) const;
 
@@ -30,6 +45,10 @@ public:
 
     void Erase(size_t pos, size_t count = 1);
 
+    /// Appends items of \p dictionary at positions given by \p index.
+    template <typename IndexType>
+    void Gather(const ColumnVector<T> & dictionary, const ColumnVector<IndexType> & index);
+
 public:
     /// Appends content of given column to the end of current one.
     void Append(ColumnRef column) override;
@@ -43,11 +62,21 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
+
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
 
     ItemView GetItem(size_t index) const override;
@@ -56,6 +85,25 @@ private:
     std::vector<T> data_;
 };
 
+template <typename T>
+template <typename IndexType>
+void ColumnVector<T>::Gather(const ColumnVector<T> & dictionary, const ColumnVector<IndexType> & index) {
+    const size_t dictionary_size = dictionary.data_.size();
+    const auto old_size = data_.size();
+    data_.resize(old_size + index.Size());
+
+    auto pos = old_size;
+    const auto * index_data = index.GetData();
+    for (size_t i = 0; i < index.Size(); ++i) {
+        const auto item = index_data[i];
+        if (static_cast<size_t>(item) >= dictionary_size) {
+            data_.resize(old_size);
+            throw ValidationError("Index is out of dictionary.");
+        }
+        data_[pos++] = dictionary.data_[item];
+    }
+}
+
 using Int128 = absl::int128;
 using Int64 = int64_t;
 
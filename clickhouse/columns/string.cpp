@@ -30,6 +30,12 @@ ColumnFixedString::ColumnFixedString(size_t n)
 {
 }
 
+ColumnFixedString::ColumnFixedString(TypeRef type, size_t n)
+    : Column(std::move(type))
+    , string_size_(n)
+{
+}
+
 void ColumnFixedString::Append(std::string_view str) {
     if (str.size() > string_size_) {
         throw ValidationError("Expected string of length not greater than "
@@ -54,6 +60,14 @@ void ColumnFixedString::Clear() {
     data_.clear();
 }
 
+void ColumnFixedString::Reserve(size_t new_cap) {
+    data_.reserve(new_cap * string_size_);
+}
+
+void ColumnFixedString::ShrinkToFit() {
+    data_.shrink_to_fit();
+}
+
 std::string_view ColumnFixedString::At(size_t n) const {
     const auto pos = n * string_size_;
     return std::string_view(&data_.at(pos), string_size_);
@@ -69,6 +83,34 @@ size_t ColumnFixedString::FixedSize() const
        return string_size_;
 }
 
+template <typename T>
+void ColumnFixedString::Gather(const ColumnFixedString & dictionary, const ColumnVector<T> & index) {
+    if (string_size_ != dictionary.string_size_)
+        throw ValidationError("Can't gather FixedString(" + std::to_string(string_size_) + ") values from FixedString("
+                + std::to_string(dictionary.string_size_) + ") dictionary.");
+
+    const size_t rows = index.Size();
+    const size_t dictionary_size = dictionary.Size();
+    const auto * index_data = index.GetData();
+    const auto old_size = data_.size();
+    data_.resize(old_size + rows * string_size_);
+
+    auto pos = old_size;
+    for (size_t i = 0; i < rows; ++i, pos += string_size_) {
+        const auto item = static_cast<size_t>(index_data[i]);
+        if (item >= dictionary_size) {
+            data_.resize(old_size);
+            throw ValidationError("Index is out of dictionary.");
+        }
+        memcpy(&data_[pos], &dictionary.data_[item * string_size_], string_size_);
+    }
+}
+
+template void ColumnFixedString::Gather(const ColumnFixedString &, const ColumnUInt8 &);
+template void ColumnFixedString::Gather(const ColumnFixedString &, const ColumnUInt16 &);
+template void ColumnFixedString::Gather(const ColumnFixedString &, const ColumnUInt32 &);
+template void ColumnFixedString::Gather(const ColumnFixedString &, const ColumnUInt64 &);
+
 void ColumnFixedString::Append(ColumnRef column) {
     if (auto col = column->As<ColumnFixedString>()) {
         if (string_size_ == col->string_size_) {
@@ -87,7 +129,7 @@ bool ColumnFixedString::Load(InputStream * input, size_t rows) {
 }
 
 void ColumnFixedString::Save(OutputStream* output) {
-    WireFormat::WriteBytes(*output, data_.data(), data_.size());
+    WireFormat::WriteBytesRef(*output, data_.data(), data_.size());
 }
 
 size_t ColumnFixedString::Size() const {
@@ -106,6 +148,10 @@ ColumnRef ColumnFixedString::Slice(size_t begin, size_t len) const {
     return result;
 }
 
+ColumnRef ColumnFixedString::CloneEmpty() const {
+    return ColumnRef{new ColumnFixedString(type_, string_size_)};
+}
+
 void ColumnFixedString::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnFixedString &>(other);
     std::swap(string_size_, col.string_size_);
@@ -116,48 +162,6 @@ ItemView ColumnFixedString::GetItem(size_t index) const {
     return ItemView{Type::FixedString, this->At(index)};
 }
 
-struct ColumnString::Block
-{
-    using CharT = typename std::string::value_type;
-
-    explicit Block(size_t starting_capacity)
-        : size(0),
-          capacity(starting_capacity),
-          data_(new CharT[capacity])
-    {}
-
-    inline auto GetAvailable() const
-    {
-        return capacity - size;
-    }
-
-    std::string_view AppendUnsafe(std::string_view str)
-    {
-        const auto pos = &data_[size];
-
-        memcpy(pos, str.data(), str.size());
-        size += str.size();
-
-        return std::string_view(pos, str.size());
-    }
-
-    auto GetCurrentWritePos()
-    {
-        return &data_[size];
-    }
-
-    std::string_view ConsumeTailAsStringViewUnsafe(size_t len)
-    {
-        const auto start = &data_[size];
-        size += len;
-        return std::string_view(start, len);
-    }
-
-    size_t size;
-    const size_t capacity;
-    std::unique_ptr<CharT[]> data_;
-};
-
 ColumnString::ColumnString()
     : Column(Type::CreateString())
 {
@@ -166,12 +170,12 @@ ColumnString::ColumnString()
 ColumnString::ColumnString(const std::vector<std::string> & data)
     : Column(Type::CreateString())
 {
-    items_.reserve(data.size());
-    blocks_.emplace_back(ComputeTotalSize(data));
+    offsets_.reserve(data.size());
+    chars_.reserve(ComputeTotalSize(data));
 
     for (const auto & s : data)
     {
-        AppendUnsafe(s);
+        Append(s);
     }
 }
 
@@ -179,102 +183,163 @@ ColumnString::~ColumnString()
 {}
 
 void ColumnString::Append(std::string_view str) {
-    if (blocks_.size() == 0 || blocks_.back().GetAvailable() < str.length())
-    {
-        blocks_.emplace_back(std::max(DEFAULT_BLOCK_SIZE, str.size()));
-    }
+    chars_.append(str.data(), str.size());
+    offsets_.push_back(chars_.size());
+}
 
-    items_.emplace_back(blocks_.back().AppendUnsafe(str));
+void ColumnString::Clear() {
+    offsets_.clear();
+    chars_.clear();
 }
 
-void ColumnString::AppendUnsafe(std::string_view str)
-{
-    items_.emplace_back(blocks_.back().AppendUnsafe(str));
+void ColumnString::Reserve(size_t new_cap) {
+    // Size of values is not known.
+    offsets_.reserve(new_cap);
 }
 
-void ColumnString::Clear() {
-    items_.clear();
-    blocks_.clear();
+void ColumnString::ShrinkToFit() {
+    offsets_.shrink_to_fit();
+    chars_.shrink_to_fit();
 }
 
 std::string_view ColumnString::At(size_t n) const {
-    return items_.at(n);
+    const auto end = offsets_.at(n);
+    return std::string_view(chars_.data() + StartOf(n), end - StartOf(n));
 }
 
 std::string_view ColumnString::operator [] (size_t n) const {
-    return items_[n];
+    return std::string_view(chars_.data() + StartOf(n), offsets_[n] - StartOf(n));
+}
+
+template <typename T>
+void ColumnString::Gather(const ColumnString & dictionary, const ColumnVector<T> & index) {
+    const size_t rows = index.Size();
+    const size_t dictionary_size = dictionary.Size();
+    const auto * index_data = index.GetData();
+
+    // Sizes of all the values are known from the offsets of the dictionary, so storage is allocated once.
+    size_t total_size = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        const auto item = static_cast<size_t>(index_data[i]);
+        if (item >= dictionary_size)
+            throw ValidationError("Index is out of dictionary.");
+        total_size += dictionary.offsets_[item] - dictionary.StartOf(item);
+    }
+
+    chars_.reserve(chars_.size() + total_size);
+    offsets_.reserve(offsets_.size() + rows);
+
+    for (size_t i = 0; i < rows; ++i) {
+        const auto item = static_cast<size_t>(index_data[i]);
+        const auto start = dictionary.StartOf(item);
+        chars_.append(dictionary.chars_, start, dictionary.offsets_[item] - start);
+        offsets_.push_back(chars_.size());
+    }
 }
 
+template void ColumnString::Gather(const ColumnString &, const ColumnUInt8 &);
+template void ColumnString::Gather(const ColumnString &, const ColumnUInt16 &);
+template void ColumnString::Gather(const ColumnString &, const ColumnUInt32 &);
+template void ColumnString::Gather(const ColumnString &, const ColumnUInt64 &);
+
 void ColumnString::Append(ColumnRef column) {
     if (auto col = column->As<ColumnString>()) {
-        const auto total_size = ComputeTotalSize(col->items_);
+        const auto base = chars_.size();
 
-        // TODO: fill up existing block with some items and then add a new one for the rest of items
-        if (blocks_.size() == 0 || blocks_.back().GetAvailable() < total_size)
-            blocks_.emplace_back(std::max(DEFAULT_BLOCK_SIZE, total_size));
-        items_.reserve(items_.size() + col->Size());
-
-        for (size_t i = 0; i < column->Size(); ++i) {
-            this->AppendUnsafe((*col)[i]);
+        chars_.append(col->chars_);
+        offsets_.reserve(offsets_.size() + col->offsets_.size());
+        for (const auto offset : col->offsets_) {
+            offsets_.push_back(base + offset);
         }
     }
 }
 
 bool ColumnString::Load(InputStream* input, size_t rows) {
-    items_.clear();
-    blocks_.clear();
+    offsets_.clear();
+    chars_.clear();
+
+    offsets_.reserve(rows);
+
+    size_t loaded = 0;
+    while (loaded < rows) {
+        const void* ptr = nullptr;
+        const size_t size = input->Peek(&ptr, 1);
+        const uint8_t* const begin = static_cast<const uint8_t*>(ptr);
+        const uint8_t* const end = begin + size;
+        const uint8_t* pos = begin;
+
+        // Rows which are entirely in the buffer of the input.
+        while (loaded < rows && pos < end) {
+            uint64_t len;
+            const size_t varint_size = WireFormat::DecodeVarint64(pos, end - pos, &len);
+            if (varint_size == 0 || len > size_t(end - pos) - varint_size)
+                break;
+
+            pos += varint_size;
+            chars_.append(reinterpret_cast<const char*>(pos), len);
+            offsets_.push_back(chars_.size());
+            pos += len;
+            ++loaded;
+        }
+        input->Consume(pos - begin);
 
-    items_.reserve(rows);
-    Block * block = nullptr;
+        if (loaded == rows)
+            break;
+        if (pos == end && pos != begin)
+            continue;
 
-    // TODO(performance): unroll a loop to a first row (to get rid of `blocks_.size() == 0` check) and the rest.
-    for (size_t i = 0; i < rows; ++i) {
+        // The row crosses the end of the buffer, or the input can't be peeked.
         uint64_t len;
         if (!WireFormat::ReadUInt64(*input, &len))
             return false;
 
-        if (blocks_.size() == 0 || len > block->GetAvailable())
-            block = &blocks_.emplace_back(std::max<size_t>(DEFAULT_BLOCK_SIZE, len));
-
-        if (!WireFormat::ReadBytes(*input, block->GetCurrentWritePos(), len))
+        const auto offset = chars_.size();
+        chars_.resize(offset + len);
+        if (!WireFormat::ReadBytes(*input, chars_.data() + offset, len))
             return false;
 
-        items_.emplace_back(block->ConsumeTailAsStringViewUnsafe(len));
+        offsets_.push_back(chars_.size());
+        ++loaded;
     }
 
     return true;
 }
 
 void ColumnString::Save(OutputStream* output) {
-    for (const auto & item : items_) {
-        WireFormat::WriteString(*output, item);
+    for (size_t i = 0; i < offsets_.size(); ++i) {
+        WireFormat::WriteString(*output, (*this)[i]);
     }
 }
 
 size_t ColumnString::Size() const {
-    return items_.size();
+    return offsets_.size();
 }
 
 ColumnRef ColumnString::Slice(size_t begin, size_t len) const {
     auto result = std::make_shared<ColumnString>();
 
-    if (begin < items_.size()) {
-        len = std::min(len, items_.size() - begin);
+    if (begin < offsets_.size() && len > 0) {
+        len = std::min(len, offsets_.size() - begin);
 
-        result->blocks_.emplace_back(ComputeTotalSize(items_, begin, len));
-        for (size_t i = begin; i < begin + len; ++i)
-        {
-            result->Append(items_[i]);
+        const auto base = StartOf(begin);
+        result->chars_.assign(chars_, base, offsets_[begin + len - 1] - base);
+        result->offsets_.reserve(len);
+        for (size_t i = begin; i < begin + len; ++i) {
+            result->offsets_.push_back(offsets_[i] - base);
         }
     }
 
     return result;
 }
 
+ColumnRef ColumnString::CloneEmpty() const {
+    return std::make_shared<ColumnString>();
+}
+
 void ColumnString::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnString &>(other);
-    items_.swap(col.items_);
-    blocks_.swap(col.blocks_);
+    offsets_.swap(col.offsets_);
+    chars_.swap(col.chars_);
 }
 
 ItemView ColumnString::GetItem(size_t index) const {
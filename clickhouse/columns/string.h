@@ -1,6 +1,7 @@
 #pragma once
 
 #include "column.h"
+#include "numeric.h"
 
 #include <string>
 #include <string_view>
@@ -38,6 +39,10 @@ public:
     /// Returns the max size of the fixed string
     size_t FixedSize() const;
 
+    /// Appends items of \p dictionary at positions given by \p index.
+    template <typename T>
+    void Gather(const ColumnFixedString & dictionary, const ColumnVector<T> & index);
+
 public:
     /// Appends content of given column to the end of current one.
     void Append(ColumnRef column) override;
@@ -51,16 +56,28 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
 
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
 
     ItemView GetItem(size_t) const override;
 
+private:
+    ColumnFixedString(TypeRef type, size_t n);
+
 private:
     size_t string_size_;
     std::string data_;
@@ -68,6 +85,9 @@ private:
 
 /**
  * Represents column of variable-length strings.
+ *
+ * Strings are stored one after another in a single buffer, along with offsets of their ends,
+ * as the server does. Appending to the column invalidates values returned by At().
  */
 class ColumnString : public Column {
 public:
@@ -90,6 +110,10 @@ public:
     /// Returns element at given row number.
     std::string_view operator [] (size_t n) const;
 
+    /// Appends items of \p dictionary at positions given by \p index.
+    template <typename T>
+    void Gather(const ColumnString & dictionary, const ColumnVector<T> & index);
+
 public:
     /// Appends content of given column to the end of current one.
     void Append(ColumnRef column) override;
@@ -103,22 +127,38 @@ public:
     /// Clear column data .
     void Clear() override;
 
+    /// Reserves memory for \p new_cap rows.
+    void Reserve(size_t new_cap) override;
+
+    /// Releases memory which is not used by the column data.
+    void ShrinkToFit() override;
+
     /// Returns count of rows in the column.
     size_t Size() const override;
 
     /// Makes slice of the current column.
     ColumnRef Slice(size_t begin, size_t len) const override;
+
+    /// Makes an empty column of the same type.
+    ColumnRef CloneEmpty() const override;
+
     void Swap(Column& other) override;
     ItemView GetItem(size_t) const override;
 
-private:
-    void AppendUnsafe(std::string_view);
+protected:
+    /// Lets LowCardinalitySerializationAdaptor take over an empty column.
+    ColumnString(ColumnString&&) = default;
 
 private:
-    struct Block;
+    /// Offset of the n-th string in chars_.
+    inline size_t StartOf(size_t n) const {
+        return n ? offsets_[n - 1] : 0;
+    }
 
-    std::vector<std::string_view> items_;
-    std::vector<Block> blocks_;
+private:
+    /// Offset of the end of each string in chars_.
+    std::vector<uint64_t> offsets_;
+    std::string chars_;
 };
 
 }
@@ -16,6 +16,12 @@ ColumnTuple::ColumnTuple(const std::vector<ColumnRef>& columns)
 {
 }
 
+ColumnTuple::ColumnTuple(TypeRef type, std::vector<ColumnRef> columns)
+    : Column(std::move(type))
+    , columns_(std::move(columns))
+{
+}
+
 size_t ColumnTuple::TupleSize() const {
     return columns_.size();
 }
@@ -44,6 +50,16 @@ ColumnRef ColumnTuple::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnTuple>(sliced_columns);
 }
 
+ColumnRef ColumnTuple::CloneEmpty() const {
+    std::vector<ColumnRef> columns;
+    columns.reserve(columns_.size());
+    for (const auto& column : columns_) {
+        columns.push_back(column->CloneEmpty());
+    }
+
+    return ColumnRef{new ColumnTuple(type_, std::move(columns))};
+}
+
 bool ColumnTuple::Load(InputStream* input, size_t rows) {
     for (auto ci = columns_.begin(); ci != columns_.end(); ++ci) {
         if (!(*ci)->Load(input, rows)) {
@@ -61,7 +77,21 @@ void ColumnTuple::Save(OutputStream* output) {
 }
 
 void ColumnTuple::Clear() {
-    columns_.clear();
+    for (auto & column : columns_) {
+        column->Clear();
+    }
+}
+
+void ColumnTuple::Reserve(size_t new_cap) {
+    for (auto & column : columns_) {
+        column->Reserve(new_cap);
+    }
+}
+
+void ColumnTuple::ShrinkToFit() {
+    for (auto & column : columns_) {
+        column->ShrinkToFit();
+    }
 }
 
 void ColumnTuple::Swap(Column& other) {
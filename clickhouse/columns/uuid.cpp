@@ -30,6 +30,15 @@ void ColumnUUID::Clear() {
     data_->Clear();
 }
 
+void ColumnUUID::Reserve(size_t new_cap) {
+    // Each UUID is stored as two UInt64.
+    data_->Reserve(new_cap * 2);
+}
+
+void ColumnUUID::ShrinkToFit() {
+    data_->ShrinkToFit();
+}
+
 const UInt128 ColumnUUID::At(size_t n) const {
     return UInt128(data_->At(n * 2), data_->At(n * 2 + 1));
 }
@@ -60,6 +69,10 @@ ColumnRef ColumnUUID::Slice(size_t begin, size_t len) const {
     return std::make_shared<ColumnUUID>(data_->Slice(begin * 2, len * 2));
 }
 
+ColumnRef ColumnUUID::CloneEmpty() const {
+    return std::make_shared<ColumnUUID>(data_->CloneEmpty());
+}
+
 void ColumnUUID::Swap(Column& other) {
     auto & col = dynamic_cast<ColumnUUID &>(other);
     data_.swap(col.data_);
@@ -30,10 +30,18 @@ class OpenSSLError : public Error {
     using Error::Error;
 };
 
-class LZ4Error : public Error {
+class CompressionError : public Error {
     using Error::Error;
 };
 
+class LZ4Error : public CompressionError {
+    using CompressionError::CompressionError;
+};
+
+class ZSTDError : public CompressionError {
+    using CompressionError::CompressionError;
+};
+
 class ServerException : public Error {
 public:
     ServerException(std::unique_ptr<Exception> e)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace clickhouse {
 
     /// То, что передаёт сервер.
@@ -16,6 +18,7 @@ namespace clickhouse {
             Extremes             = 8,    /// Блок данных с минимумами и максимумами, аналогично.
             TablesStatusResponse = 9,    /// Ответ на запрос TableStatus.
             Log                  = 10,   /// Системный лог исполнения запроса.
+            TableColumns         = 11,   /// Columns' description for default values calculation.
         };
     }
 
@@ -33,6 +36,22 @@ namespace clickhouse {
         };
     }
 
+    /// Methods of block compression.
+    enum class CompressionMethod {
+        None    = -1,
+        LZ4     =  1,
+        ZSTD    =  2,
+    };
+
+    /// Method of compression of an individual frame, see DB::CompressionMethodByte of ClickHouse project.
+    namespace CompressionMethodByte {
+        enum : uint8_t {
+            NONE        = 0x02,
+            LZ4         = 0x82,
+            ZSTD        = 0x90,
+        };
+    }
+
     /// Использовать ли сжатие.
     namespace CompressionState {
         enum {
@@ -7,31 +7,28 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace clickhouse {
 
+struct QuerySettingsField {
+    enum Flags : uint64_t {
+        /// Server fails the query if the setting is unknown, otherwise unknown settings are ignored.
+        IMPORTANT = 0x01,
+        CUSTOM = 0x02,
+        OBSOLETE = 0x04,
+    };
+
+    /// Value of the setting, as it would be written in a SETTINGS clause, e.g. "8" or "lz4".
+    std::string value;
+    uint64_t flags = 0;
+};
+
 /**
- * Settings of individual query.
+ * Settings of individual query, are serialized on the wire as strings:
+ * any server-side setting could be set, e.g. max_block_size, max_threads or async_insert.
  */
-struct QuerySettings {
-    /// Максимальное количество потоков выполнения запроса. По-умолчанию - определять автоматически.
-    int max_threads = 0;
-    /// Считать минимумы и максимумы столбцов результата.
-    bool extremes = false;
-    /// Тихо пропускать недоступные шарды.
-    bool skip_unavailable_shards = false;
-    /// Write statistics about read rows, bytes, time elapsed, etc.
-    bool output_format_write_statistics = true;
-    /// Use client timezone for interpreting DateTime string values, instead of adopting server timezone.
-    bool use_client_time_zone = false;
-
-    // connect_timeout
-    // max_block_size
-    // distributed_group_by_no_merge = false
-    // strict_insert_defaults = 0
-    // network_compression_method = LZ4
-    // priority = 0
-};
+using QuerySettings = std::unordered_map<std::string, QuerySettingsField>;
 
 
 struct Profile {
@@ -48,6 +45,8 @@ struct Progress {
     uint64_t rows = 0;
     uint64_t bytes = 0;
     uint64_t total_rows = 0;
+    uint64_t written_rows = 0;
+    uint64_t written_bytes = 0;
 };
 
 
@@ -62,6 +61,9 @@ public:
 
     virtual void OnServerException(const Exception& e) = 0;
 
+    /// Log entries of the query sent by the server, if `send_logs_level` setting is set.
+    virtual void OnServerLog(const Block& /*block*/) { }
+
     virtual void OnProfile(const Profile& profile) = 0;
 
     virtual void OnProgress(const Progress& progress) = 0;
@@ -72,6 +74,7 @@ public:
 
 using ExceptionCallback        = std::function<void(const Exception& e)>;
 using ProgressCallback         = std::function<void(const Progress& progress)>;
+using ServerLogCallback        = std::function<void(const Block& block)>;
 using SelectCallback           = std::function<void(const Block& block)>;
 using SelectCancelableCallback = std::function<bool(const Block& block)>;
 
@@ -92,6 +95,22 @@ public:
         return query_id_;
     }
 
+    inline const QuerySettings& GetQuerySettings() const {
+        return query_settings_;
+    }
+
+    /// Set per query settings, they override settings of the same name set in ClientOptions.
+    inline Query& SetQuerySettings(QuerySettings query_settings) {
+        query_settings_ = std::move(query_settings);
+        return *this;
+    }
+
+    /// Set per query setting.
+    inline Query& SetSetting(const std::string& name, const QuerySettingsField& value) {
+        query_settings_[name] = value;
+        return *this;
+    }
+
     /// Set handler for receiving result data.
     inline Query& OnData(SelectCallback cb) {
         select_cb_ = std::move(cb);
@@ -116,6 +135,12 @@ public:
         return *this;
     }
 
+    /// Set handler for receiving server log entries of the query.
+    inline Query& OnServerLog(ServerLogCallback cb) {
+        server_log_cb_ = std::move(cb);
+        return *this;
+    }
+
     static const std::string default_query_id;
 
 private:
@@ -139,6 +164,12 @@ private:
         }
     }
 
+    void OnServerLog(const Block& block) override {
+        if (server_log_cb_) {
+            server_log_cb_(block);
+        }
+    }
+
     void OnProfile(const Profile& profile) override {
         (void)profile;
     }
@@ -155,8 +186,10 @@ private:
 private:
     const std::string query_;
     const std::string query_id_;
+    QuerySettings query_settings_;
     ExceptionCallback exception_cb_;
     ProgressCallback progress_cb_;
+    ServerLogCallback server_log_cb_;
     SelectCallback select_cb_;
     SelectCancelableCallback select_cancelable_cb_;
 };
@@ -240,14 +240,24 @@ const TypeAst* ParseTypeName(const std::string& type_name) {
     static std::map<std::string, TypeAst> ast_cache;
     static std::mutex lock;
 
+    // Parsed entries are never removed from ast_cache, so each thread remembers
+    // pointers to them and takes the lock only for names it has not seen yet.
+    thread_local std::unordered_map<std::string, const TypeAst*> local_cache;
+    auto local = local_cache.find(type_name);
+    if (local != local_cache.end()) {
+        return local->second;
+    }
+
     std::lock_guard<std::mutex> guard(lock);
     auto it = ast_cache.find(type_name);
     if (it != ast_cache.end()) {
+        local_cache.emplace(type_name, &it->second);
         return &it->second;
     }
 
     auto& ast = ast_cache[type_name];
     if (TypeParser(type_name).Parse(&ast)) {
+        local_cache.emplace(type_name, &ast);
         return &ast;
     }
     ast_cache.erase(type_name);
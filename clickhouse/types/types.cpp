@@ -140,10 +140,15 @@ TypeRef Type::CreateArray(TypeRef item_type) {
 }
 
 TypeRef Type::CreateDate() {
-    return TypeRef(new Type(Type::Date));
+    static const TypeRef type(new Type(Type::Date));
+    return type;
 }
 
 TypeRef Type::CreateDateTime(std::string timezone) {
+    if (timezone.empty()) {
+        static const TypeRef type(new DateTimeType(std::string()));
+        return type;
+    }
     return TypeRef(new DateTimeType(std::move(timezone)));
 }
 
@@ -156,15 +161,18 @@ TypeRef Type::CreateDecimal(size_t precision, size_t scale) {
 }
 
 TypeRef Type::CreateIPv4() {
-    return TypeRef(new Type(Type::IPv4));
+    static const TypeRef type(new Type(Type::IPv4));
+    return type;
 }
 
 TypeRef Type::CreateIPv6() {
-    return TypeRef(new Type(Type::IPv6));
+    static const TypeRef type(new Type(Type::IPv6));
+    return type;
 }
 
 TypeRef Type::CreateNothing() {
-    return TypeRef(new Type(Type::Void));
+    static const TypeRef type(new Type(Type::Void));
+    return type;
 }
 
 TypeRef Type::CreateNullable(TypeRef nested_type) {
@@ -172,7 +180,8 @@ TypeRef Type::CreateNullable(TypeRef nested_type) {
 }
 
 TypeRef Type::CreateString() {
-    return TypeRef(new Type(Type::String));
+    static const TypeRef type(new Type(Type::String));
+    return type;
 }
 
 TypeRef Type::CreateString(size_t n) {
@@ -192,7 +201,8 @@ TypeRef Type::CreateEnum16(const std::vector<EnumItem>& enum_items) {
 }
 
 TypeRef Type::CreateUUID() {
-    return TypeRef(new Type(Type::UUID));
+    static const TypeRef type(new Type(Type::UUID));
+    return type;
 }
 
 TypeRef Type::CreateLowCardinality(TypeRef item_type) {
@@ -84,6 +84,8 @@ public:
     bool IsEqual(const TypeRef& other) const { return IsEqual(*other); }
 
 public:
+    // Types are immutable, so types without parameters are created once and shared.
+
     static TypeRef CreateArray(TypeRef item_type);
 
     static TypeRef CreateDate();
@@ -276,57 +278,68 @@ private:
 
 template <>
 inline TypeRef Type::CreateSimple<int8_t>() {
-    return TypeRef(new Type(Int8));
+    static const TypeRef type(new Type(Int8));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<int16_t>() {
-    return TypeRef(new Type(Int16));
+    static const TypeRef type(new Type(Int16));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<int32_t>() {
-    return TypeRef(new Type(Int32));
+    static const TypeRef type(new Type(Int32));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<int64_t>() {
-    return TypeRef(new Type(Int64));
+    static const TypeRef type(new Type(Int64));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<Int128>() {
-    return TypeRef(new Type(Int128));
+    static const TypeRef type(new Type(Int128));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<uint8_t>() {
-    return TypeRef(new Type(UInt8));
+    static const TypeRef type(new Type(UInt8));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<uint16_t>() {
-    return TypeRef(new Type(UInt16));
+    static const TypeRef type(new Type(UInt16));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<uint32_t>() {
-    return TypeRef(new Type(UInt32));
+    static const TypeRef type(new Type(UInt32));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<uint64_t>() {
-    return TypeRef(new Type(UInt64));
+    static const TypeRef type(new Type(UInt64));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<float>() {
-    return TypeRef(new Type(Float32));
+    static const TypeRef type(new Type(Float32));
+    return type;
 }
 
 template <>
 inline TypeRef Type::CreateSimple<double>() {
-    return TypeRef(new Type(Float64));
+    static const TypeRef type(new Type(Float64));
+    return type;
 }
 
 }  // namespace clickhouse
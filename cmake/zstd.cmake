@@ -0,0 +1,12 @@
+MACRO (USE_ZSTD)
+
+    IF (WITH_ZSTD)
+        FIND_PATH (ZSTD_INCLUDE_DIR NAMES zstd.h)
+        FIND_LIBRARY (ZSTD_LIBRARY NAMES zstd)
+        IF (NOT ZSTD_INCLUDE_DIR OR NOT ZSTD_LIBRARY)
+            MESSAGE (FATAL_ERROR "ZSTD library is not found")
+        ENDIF ()
+        ADD_COMPILE_DEFINITIONS (WITH_ZSTD=1)
+    ENDIF ()
+
+ENDMACRO ()
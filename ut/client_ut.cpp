@@ -1,4 +1,6 @@
+#include <clickhouse/batching_inserter.h>
 #include <clickhouse/client.h>
+#include <clickhouse/client_pool.h>
 
 #include "readonly_client_test.h"
 #include "connection_failed_client_test.h"
@@ -6,6 +8,7 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cmath>
 #include <thread>
 #include <chrono>
@@ -426,6 +429,74 @@ TEST_P(ClientCase, Numbers) {
     EXPECT_EQ(100000U, num);
 }
 
+TEST_P(ClientCase, ReuseResultColumns) {
+    client_ = std::make_unique<Client>(ClientOptions(GetParam()).SetReuseResultColumns(true));
+
+    for (int query = 0; query < 2; ++query) {
+        size_t num = 0;
+        const Column * number_column = nullptr;
+        client_->Select("SELECT number, toString(number) FROM system.numbers LIMIT 100000 SETTINGS max_block_size = 1000",
+            [&num, &number_column](const Block& block) {
+                if (block.GetRowCount() == 0) {
+                    return;
+                }
+                // Blocks of a query are loaded into the same columns.
+                if (number_column) {
+                    EXPECT_EQ(number_column, block[0].get());
+                }
+                number_column = block[0].get();
+
+                auto numbers = block[0]->As<ColumnUInt64>();
+                auto strings = block[1]->As<ColumnString>();
+                ASSERT_EQ(block.GetRowCount(), numbers->Size());
+                ASSERT_EQ(block.GetRowCount(), strings->Size());
+
+                for (size_t i = 0; i < numbers->Size(); ++i, ++num) {
+                    EXPECT_EQ(num, numbers->At(i));
+                    EXPECT_EQ(std::to_string(num), strings->At(i));
+                }
+            }
+        );
+        EXPECT_EQ(100000U, num);
+    }
+}
+
+TEST_P(ClientCase, BlockSchemaOfEachQuery) {
+    // Same column name with a different type in the next query.
+    const char* queries[] = {
+        "SELECT number AS x FROM system.numbers LIMIT 10 SETTINGS max_block_size = 3",
+        "SELECT toString(number) AS x FROM system.numbers LIMIT 10 SETTINGS max_block_size = 3",
+    };
+
+    for (const auto query : queries) {
+        size_t num = 0;
+        std::vector<ColumnRef> columns;
+        client_->Select(query, [&num, &columns](const Block& block) {
+            if (block.GetRowCount() == 0) {
+                return;
+            }
+            ASSERT_EQ(1U, block.GetColumnCount());
+            EXPECT_EQ("x", block.GetColumnName(0));
+            columns.push_back(block[0]);
+
+            for (size_t i = 0; i < block.GetRowCount(); ++i, ++num) {
+                if (auto numbers = block[0]->As<ColumnUInt64>()) {
+                    EXPECT_EQ(num, numbers->At(i));
+                } else {
+                    ASSERT_NE(nullptr, block[0]->As<ColumnString>());
+                    EXPECT_EQ(std::to_string(num), block[0]->As<ColumnString>()->At(i));
+                }
+            }
+        });
+        EXPECT_EQ(10U, num);
+
+        // Blocks kept by the caller are not overwritten by the following ones.
+        ASSERT_LT(1U, columns.size());
+        EXPECT_NE(columns[0], columns[1]);
+        EXPECT_EQ(3U, columns[0]->Size());
+    }
+}
+
 TEST_P(ClientCase, SimpleAggregateFunction) {
     const auto & server_info = client_->GetServerInfo();
     if (versionNumber(server_info) < versionNumber(19, 9)) {
@@ -913,6 +984,364 @@ TEST_P(ClientCase, Query_ID) {
     EXPECT_EQ(5u, total_count);
 }
 
+TEST_P(ClientCase, BeginInsert) {
+    const std::string table_name = "test_clickhouse_cpp_begin_insert";
+    client_->Execute("CREATE TEMPORARY TABLE IF NOT EXISTS " + table_name + " (id UInt64, name String)");
+
+    {
+        auto inserter = client_->BeginInsert(table_name);
+
+        const Block& header = inserter.GetHeader();
+        ASSERT_EQ(2u, header.GetColumnCount());
+        EXPECT_EQ(0u, header.GetRowCount());
+        EXPECT_EQ("id", header.GetColumnName(0));
+        EXPECT_EQ("UInt64", header[0]->Type()->GetName());
+        EXPECT_EQ("name", header.GetColumnName(1));
+        EXPECT_EQ("String", header[1]->Type()->GetName());
+
+        // Another query can't be sent while the INSERT is in progress.
+        EXPECT_THROW(client_->Ping(), ValidationError);
+
+        for (uint64_t i = 0; i < 10; ++i) {
+            Block block;
+            block.AppendColumn("id", std::make_shared<ColumnUInt64>(std::vector<uint64_t>{i * 2, i * 2 + 1}));
+            block.AppendColumn("name", std::make_shared<ColumnString>(std::vector<std::string>{"a", "b"}));
+            inserter.SendBlock(block);
+        }
+        inserter.Finish();
+
+        EXPECT_THROW(inserter.Finish(), ValidationError);
+    }
+
+    uint64_t total_rows = 0, sum = 0;
+    client_->Select("SELECT count(), sum(id) FROM " + table_name, [&](const Block& block) {
+        if (block.GetRowCount() == 0) {
+            return;
+        }
+        total_rows = block[0]->As<ColumnUInt64>()->At(0);
+        sum = block[1]->As<ColumnUInt64>()->At(0);
+    });
+    EXPECT_EQ(20u, total_rows);
+    EXPECT_EQ(190u, sum);
+}
+
+TEST_P(ClientCase, BeginInsert_Abort) {
+    const std::string table_name = "test_clickhouse_cpp_begin_insert_abort";
+    client_->Execute("CREATE TABLE IF NOT EXISTS " + table_name + " (id UInt64) ENGINE = Memory");
+    client_->Execute("TRUNCATE TABLE " + table_name);
+
+    {
+        auto inserter = client_->BeginInsert(table_name);
+        // Destroyed without Finish(): the query is aborted and the connection is re-established.
+    }
+
+    // The client is usable after the INSERT was aborted.
+    client_->Ping();
+
+    Block block;
+    block.AppendColumn("id", std::make_shared<ColumnUInt64>(std::vector<uint64_t>{1, 2, 3}));
+    client_->Insert(table_name, block);
+
+    size_t total_rows = 0;
+    client_->Select("SELECT id FROM " + table_name, [&total_rows](const Block& block) {
+        total_rows += block.GetRowCount();
+    });
+    EXPECT_EQ(3u, total_rows);
+
+    client_->Execute("DROP TABLE " + table_name);
+}
+
+TEST_P(ClientCase, FailedInsert) {
+    const std::string table_name = "test_clickhouse_cpp_failed_insert";
+    // Not a temporary table, since the connection is re-established after the failure.
+    client_->Execute("CREATE TABLE IF NOT EXISTS " + table_name + " (id UInt64) ENGINE = Memory");
+    client_->Execute("TRUNCATE TABLE " + table_name);
+
+    // Arrays can't be converted to the type of the column, the server rejects the data.
+    auto ids = std::make_shared<ColumnArray>(std::make_shared<ColumnUInt64>());
+    ids->AppendAsColumn(std::make_shared<ColumnUInt64>(std::vector<uint64_t>{1, 2}));
+    Block block;
+    block.AppendColumn("id", ids);
+
+    EXPECT_ANY_THROW(client_->Insert(table_name, block));
+
+    // The client is usable after the INSERT failed.
+    client_->Ping();
+    {
+        auto inserter = client_->BeginInsert(table_name);
+        inserter.SendBlock(block);
+        EXPECT_ANY_THROW(inserter.Finish());
+    }
+
+    size_t total_rows = 0;
+    client_->Select("SELECT id FROM " + table_name, [&total_rows](const Block& block) {
+        total_rows += block.GetRowCount();
+    });
+    EXPECT_EQ(0u, total_rows);
+
+    client_->Execute("DROP TABLE " + table_name);
+}
+
+TEST_P(ClientCase, QuerySettings) {
+    const auto select_max_block_size = [] (Client& client, Query query) {
+        std::string value;
+        query.OnData([&value](const Block& block) {
+            if (block.GetRowCount() > 0) {
+                value = std::string(block[0]->As<ColumnString>()->At(0));
+            }
+        });
+        client.Execute(query);
+        return value;
+    };
+    const std::string query = "SELECT value FROM system.settings WHERE name = 'max_block_size'";
+
+    EXPECT_EQ("1234", select_max_block_size(*client_,
+        Query(query).SetSetting("max_block_size", {"1234", QuerySettingsField::IMPORTANT})));
+
+    // Unknown settings are ignored unless marked as important.
+    EXPECT_NO_THROW(client_->Execute(Query("SELECT 1").SetSetting("clickhouse_cpp_unknown_setting", {"1"})));
+    EXPECT_THROW(
+        client_->Execute(Query("SELECT 1").SetSetting("clickhouse_cpp_unknown_setting", {"1", QuerySettingsField::IMPORTANT})),
+        ServerException
+    );
+
+    // Per client settings are sent with every query, and could be overridden per query.
+    Client client(ClientOptions(GetParam())
+            .SetQuerySettings({{"max_block_size", {"4321", QuerySettingsField::IMPORTANT}}}));
+
+    EXPECT_EQ("4321", select_max_block_size(client, Query(query)));
+    EXPECT_EQ("5678", select_max_block_size(client,
+        Query(query).SetSetting("max_block_size", {"5678", QuerySettingsField::IMPORTANT})));
+}
+
+TEST_P(ClientCase, SelectStream) {
+    {
+        auto stream = client_->BeginSelect(
+            Query("SELECT number FROM system.numbers LIMIT 100000").SetSetting("max_block_size", {"1000"}), 2);
+
+        uint64_t num = 0;
+        while (auto block = stream.Next()) {
+            ASSERT_LT(0u, block->GetRowCount());
+            auto col = (*block)[0]->As<ColumnUInt64>();
+            for (size_t i = 0; i < col->Size(); ++i, ++num) {
+                EXPECT_EQ(num, col->At(i));
+            }
+        }
+        EXPECT_EQ(100000u, num);
+        EXPECT_FALSE(stream.Next());
+    }
+
+    // Cancelled in the middle of the result, the client stays usable.
+    {
+        auto stream = client_->BeginSelect(
+            Query("SELECT number FROM system.numbers LIMIT 10000000").SetSetting("max_block_size", {"1000"}), 2);
+        ASSERT_TRUE(stream.Next());
+        stream.Cancel();
+        EXPECT_FALSE(stream.Next());
+    }
+    client_->Ping();
+
+    // Cancelled while the query produces no rows at all.
+    {
+        auto stream = client_->BeginSelect(
+            Query("SELECT number FROM system.numbers WHERE number = 0xFFFFFFFFFFFF"));
+        const auto start = std::chrono::steady_clock::now();
+        stream.Cancel();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+        EXPECT_FALSE(stream.Next());
+    }
+    client_->Ping();
+
+    {
+        auto stream = client_->BeginSelect(Query("SELECT throwIf(1)"));
+        EXPECT_THROW(stream.Next(), ServerException);
+    }
+}
+
+TEST_P(ClientCase, SelectStreamWithReuseResultColumns) {
+    client_ = std::make_unique<Client>(ClientOptions(GetParam()).SetReuseResultColumns(true));
+
+    auto stream = client_->BeginSelect(
+        Query("SELECT number, toString(number) FROM system.numbers LIMIT 100000").SetSetting("max_block_size", {"1000"}), 4);
+
+    // Blocks are taken out of the stream first, so that the following ones are received meanwhile.
+    std::vector<Block> blocks;
+    while (auto block = stream.Next()) {
+        blocks.push_back(std::move(*block));
+    }
+    ASSERT_LT(1u, blocks.size());
+
+    uint64_t num = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        // Each block has columns of its own.
+        if (b > 0) {
+            EXPECT_NE(blocks[b - 1][0].get(), blocks[b][0].get());
+        }
+
+        auto numbers = blocks[b][0]->As<ColumnUInt64>();
+        auto strings = blocks[b][1]->As<ColumnString>();
+        ASSERT_EQ(blocks[b].GetRowCount(), numbers->Size());
+        ASSERT_EQ(blocks[b].GetRowCount(), strings->Size());
+        for (size_t i = 0; i < numbers->Size(); ++i, ++num) {
+            EXPECT_EQ(num, numbers->At(i));
+            EXPECT_EQ(std::to_string(num), strings->At(i));
+        }
+    }
+    EXPECT_EQ(100000u, num);
+
+    // Columns are reused again by the queries executed in place.
+    const Column * number_column = nullptr;
+    client_->Select("SELECT number FROM system.numbers LIMIT 10000 SETTINGS max_block_size = 1000",
+        [&number_column](const Block& block) {
+            if (block.GetRowCount() == 0) {
+                return;
+            }
+            if (number_column) {
+                EXPECT_EQ(number_column, block[0].get());
+            }
+            number_column = block[0].get();
+        }
+    );
+}
+
+TEST_P(ClientCase, ClientPool) {
+    ClientPool pool(ClientPoolOptions()
+            .SetClientOptions(GetParam())
+            .SetMaxSize(2));
+
+    {
+        auto first = pool.Acquire();
+        auto second = pool.Acquire();
+        first->Ping();
+        second->Ping();
+
+        EXPECT_EQ(2u, pool.GetStats().leased);
+    }
+
+    // Connections are reused after being returned to the pool.
+    std::vector<std::thread> workers;
+    std::atomic<size_t> total_rows{0};
+    for (size_t i = 0; i < 8; ++i) {
+        workers.emplace_back([&pool, &total_rows] {
+            auto client = pool.Acquire();
+            client->Select("SELECT number FROM system.numbers LIMIT 10", [&total_rows](const Block& block) {
+                total_rows += block.GetRowCount();
+            });
+        });
+    }
+    for (auto & worker : workers) {
+        worker.join();
+    }
+
+    const auto stats = pool.GetStats();
+    EXPECT_EQ(80u, total_rows);
+    EXPECT_EQ(2u, stats.connections_created);
+    EXPECT_EQ(10u, stats.acquired);
+    EXPECT_EQ(2u, stats.idle);
+    EXPECT_EQ(0u, stats.leased);
+}
+
+TEST_P(ClientCase, ClientPool_DiscardAndTimeout) {
+    ClientPool pool(ClientPoolOptions()
+            .SetClientOptions(GetParam())
+            .SetMaxSize(1)
+            .SetAcquireTimeout(std::chrono::milliseconds(10)));
+
+    {
+        auto client = pool.Acquire();
+        EXPECT_THROW(pool.Acquire(), clickhouse::Error);
+        client.Discard();
+    }
+
+    try {
+        auto client = pool.Acquire();
+        client->Execute("SELECT throwIf(1)");
+        FAIL() << "Exception expected";
+    } catch (const ServerException &) {
+        // the lease was destroyed due to exception, so the connection is discarded.
+    }
+
+    const auto stats = pool.GetStats();
+    EXPECT_EQ(2u, stats.connections_created);
+    EXPECT_EQ(2u, stats.connections_discarded);
+    EXPECT_EQ(1u, stats.timed_out);
+    EXPECT_EQ(0u, stats.idle);
+}
+
+TEST_P(ClientCase, BatchingInserter) {
+    const std::string table_name = "test_clickhouse_cpp_batching_inserter";
+    client_->Execute("CREATE TABLE IF NOT EXISTS " + table_name + " (id UInt64, name String) ENGINE = Memory");
+    client_->Execute("TRUNCATE TABLE " + table_name);
+
+    BatchingInserter inserter(BatchingInserterOptions()
+            .SetClientOptions(GetParam())
+            .SetMaxBlockRows(1000)
+            .SetFlushInterval(std::chrono::minutes(1)));
+
+    std::vector<std::thread> producers;
+    for (uint64_t p = 0; p < 4; ++p) {
+        producers.emplace_back([&inserter, &table_name, p] {
+            for (uint64_t i = 0; i < 500; ++i) {
+                Block block;
+                block.AppendColumn("id", std::make_shared<ColumnUInt64>(std::vector<uint64_t>{p * 1000 + i * 2, p * 1000 + i * 2 + 1}));
+                block.AppendColumn("name", std::make_shared<ColumnString>(std::vector<std::string>{"a", "b"}));
+                inserter.Add(table_name, block);
+            }
+        });
+    }
+    for (auto & producer : producers) {
+        producer.join();
+    }
+    inserter.Flush();
+
+    const auto stats = inserter.GetStats();
+    EXPECT_EQ(2000u, stats.blocks_added);
+    EXPECT_EQ(4000u, stats.rows_added);
+    EXPECT_EQ(4000u, stats.rows_inserted);
+    EXPECT_EQ(0u, stats.pending_rows);
+    EXPECT_EQ(0u, stats.pending_bytes);
+    EXPECT_EQ(0u, stats.rows_failed);
+    EXPECT_EQ(1000u, stats.max_batch_rows);
+    EXPECT_LE(4u, stats.batches_inserted);
+
+    uint64_t total_rows = 0;
+    client_->Select("SELECT count() FROM " + table_name, [&total_rows](const Block& block) {
+        if (block.GetRowCount() > 0) {
+            total_rows = block[0]->As<ColumnUInt64>()->At(0);
+        }
+    });
+    EXPECT_EQ(4000u, total_rows);
+
+    // Batch is inserted once the flush interval elapses, even if there is nothing else to add.
+    BatchingInserter timed_inserter(BatchingInserterOptions()
+            .SetClientOptions(GetParam())
+            .SetFlushInterval(std::chrono::milliseconds(10)));
+    {
+        Block block;
+        block.AppendColumn("id", std::make_shared<ColumnUInt64>(std::vector<uint64_t>{1}));
+        block.AppendColumn("name", std::make_shared<ColumnString>(std::vector<std::string>{"c"}));
+        timed_inserter.Add(table_name, block);
+    }
+    for (int i = 0; i < 500 && timed_inserter.GetStats().rows_inserted == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(1u, timed_inserter.GetStats().flushes_by_deadline);
+
+    // Errors are reported by Flush() or Close().
+    {
+        Block block;
+        block.AppendColumn("id", std::make_shared<ColumnUInt64>(std::vector<uint64_t>{1}));
+        timed_inserter.Add("test_clickhouse_cpp_batching_inserter_missing", block);
+    }
+    EXPECT_THROW(timed_inserter.Flush(), ServerException);
+    EXPECT_EQ(1u, timed_inserter.GetStats().rows_failed);
+
+    timed_inserter.Close();
+    EXPECT_THROW(timed_inserter.Add(table_name, Block()), ValidationError);
+
+    client_->Execute("DROP TABLE " + table_name);
+}
+
 const auto LocalHostEndpoint = ClientOptions()
         .SetHost(           getEnvOrDefault("CLICKHOUSE_HOST",     "localhost"))
         .SetPort(   getEnvOrDefault<size_t>("CLICKHOUSE_PORT",     "9000"))
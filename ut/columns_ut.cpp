@@ -4,6 +4,7 @@
 #include <clickhouse/columns/enum.h>
 #include <clickhouse/columns/factory.h>
 #include <clickhouse/columns/lowcardinality.h>
+#include <clickhouse/columns/lowcardinalityadaptor.h>
 #include <clickhouse/columns/nullable.h>
 #include <clickhouse/columns/numeric.h>
 #include <clickhouse/columns/string.h>
@@ -12,6 +13,7 @@
 #include <clickhouse/columns/ip6.h>
 #include <clickhouse/base/input.h>
 #include <clickhouse/base/output.h>
+#include <clickhouse/base/wire_format.h>
 #include <clickhouse/base/socket.h> // for ipv4-ipv6 platform-specific stuff
 
 #include <gtest/gtest.h>
@@ -182,6 +184,63 @@ TEST(ColumnsCase, NumericSlice) {
     ASSERT_EQ(sub->At(2), 13u);
 }
 
+TEST(ColumnsCase, NumericAppendMany) {
+    const auto numbers = MakeNumbers();
+    ColumnUInt32 col;
+    col.Reserve(numbers.size() * 2);
+    col.Append(1);
+    col.AppendMany(numbers.data(), numbers.size());
+
+    ASSERT_EQ(numbers.size() + 1, col.Size());
+    EXPECT_EQ(1u, col.At(0));
+    EXPECT_EQ(numbers.back(), col.At(numbers.size()));
+
+    // Storage is filled in place and isn't reallocated within reserved capacity.
+    const auto * data = col.GetData();
+    auto * extension = col.Extend(3);
+    EXPECT_EQ(data, col.GetData());
+    EXPECT_EQ(data + numbers.size() + 1, extension);
+    EXPECT_EQ(0u, extension[0]);
+    for (size_t i = 0; i < 3; ++i) {
+        extension[i] = static_cast<uint32_t>(100 + i);
+    }
+    col.GetWritableData()[0] = 2;
+
+    ASSERT_EQ(numbers.size() + 4, col.Size());
+    EXPECT_EQ(2u, col.At(0));
+    EXPECT_EQ(100u, col.At(numbers.size() + 1));
+    EXPECT_EQ(102u, col.At(numbers.size() + 3));
+}
+
+
+TEST(ColumnsCase, ClearKeepsCapacity) {
+    ColumnUInt32 col;
+    col.Reserve(100);
+    const auto * data = col.GetData();
+
+    col.Extend(100);
+    col.Clear();
+    col.Extend(100);
+    EXPECT_EQ(data, col.GetData());
+
+    col.Clear();
+    col.ShrinkToFit();
+    col.Append(1);
+    ASSERT_EQ(1u, col.Size());
+}
+
+TEST(ColumnsCase, TupleClear) {
+    auto tuple = CreateColumnByType("Tuple(UInt32, String)")->As<ColumnTuple>();
+    tuple->Reserve(10);
+    (*tuple)[0]->As<ColumnUInt32>()->Append(1);
+    (*tuple)[1]->As<ColumnString>()->Append("a");
+    ASSERT_EQ(1u, tuple->Size());
+
+    tuple->Clear();
+    ASSERT_EQ(2u, tuple->TupleSize());
+    EXPECT_EQ(0u, tuple->Size());
+    EXPECT_EQ(0u, (*tuple)[1]->Size());
+}
 
 TEST(ColumnsCase, FixedStringInit) {
     const auto column_data = MakeFixedStrings();
@@ -236,6 +295,70 @@ TEST(ColumnsCase, StringInit) {
     ASSERT_EQ(col->At(3), "abcd");
 }
 
+TEST(ColumnsCase, StringSliceAppendSaveLoad) {
+    auto col = std::make_shared<ColumnString>(MakeStrings());
+    col->Append("");
+    col->Append(std::string(10000, 'x'));
+
+    auto slice = col->Slice(1, 4)->As<ColumnString>();
+    ASSERT_EQ(slice->Size(), 4u);
+    EXPECT_EQ(slice->At(0), "ab");
+    EXPECT_EQ(slice->At(2), "abcd");
+    EXPECT_EQ(slice->At(3), "");
+    EXPECT_EQ(col->Slice(2, 0)->Size(), 0u);
+
+    slice->Append(col);
+    ASSERT_EQ(slice->Size(), 10u);
+    EXPECT_EQ(slice->At(4), "a");
+    EXPECT_EQ(slice->At(9), std::string(10000, 'x'));
+
+    Buffer buffer;
+    BufferOutput output(&buffer);
+    slice->Save(&output);
+
+    ArrayInput input(buffer.data(), buffer.size());
+    ColumnString loaded;
+    ASSERT_TRUE(loaded.Load(&input, slice->Size()));
+    ASSERT_EQ(loaded.Size(), slice->Size());
+    for (size_t i = 0; i < slice->Size(); ++i) {
+        EXPECT_EQ(loaded[i], (*slice)[i]);
+    }
+}
+
+TEST(ColumnsCase, StringLoadAcrossBufferBoundaries) {
+    ColumnString col;
+    for (size_t i = 0; i < 300; ++i) {
+        // Lengths of 128 and more take more than a byte.
+        col.Append(std::string((i * 37) % 300, char('a' + i % 26)));
+    }
+
+    Buffer buffer;
+    BufferOutput output(&buffer);
+    col.Save(&output);
+    // Data of the next column must be left intact.
+    const std::string tail = "tail";
+    buffer.insert(buffer.end(), tail.begin(), tail.end());
+
+    for (size_t buffer_size : {1, 2, 7, 64, 1000, 1 << 20}) {
+        SCOPED_TRACE(buffer_size);
+
+        BufferedInput input(std::make_unique<ArrayInput>(buffer.data(), buffer.size()), buffer_size);
+        ColumnString loaded;
+        ASSERT_TRUE(loaded.Load(&input, col.Size()));
+        ASSERT_EQ(loaded.Size(), col.Size());
+        for (size_t i = 0; i < col.Size(); ++i) {
+            ASSERT_EQ(loaded[i], col[i]);
+        }
+
+        std::string rest(tail.size(), '\0');
+        ASSERT_TRUE(WireFormat::ReadBytes(input, rest.data(), rest.size()));
+        EXPECT_EQ(tail, rest);
+    }
+
+    ArrayInput truncated(buffer.data(), buffer.size() - tail.size() - 1);
+    EXPECT_FALSE(ColumnString().Load(&truncated, col.Size()));
+}
+
 
 TEST(ColumnsCase, ArrayAppend) {
     auto arr1 = std::make_shared<ColumnArray>(std::make_shared<ColumnUInt64>());
@@ -813,6 +936,426 @@ TEST(ColumnsCase, ColumnLowCardinalityString_Load) {
     }
 }
 
+TEST(ColumnsCase, ColumnLowCardinalityString_LoadAgain) {
+    const size_t items_count = 10;
+    const auto & data = LOWCARDINALITY_STRING_FOOBAR_10_ITEMS_BINARY;
+    ColumnLowCardinalityT<ColumnString> col;
+    LowCardinalitySerializationAdaptor<ColumnString> adaptor;
+
+    // Columns are loaded in place, replacing the data.
+    for (int i = 0; i < 2; ++i) {
+        ArrayInput buffer(data.data(), data.size());
+        ASSERT_TRUE(col.Load(&buffer, items_count));
+        ArrayInput adaptor_buffer(data.data(), data.size());
+        ASSERT_TRUE(adaptor.Load(&adaptor_buffer, items_count));
+
+        ASSERT_EQ(items_count, col.Size());
+        ASSERT_EQ(items_count, adaptor.Size());
+        for (size_t j = 0; j < items_count; ++j) {
+            EXPECT_EQ(col.At(j), FooBarSeq(j)) << " at pos: " << j;
+            EXPECT_EQ(adaptor.At(j), FooBarSeq(j)) << " at pos: " << j;
+        }
+    }
+
+    // Failed load leaves the column empty.
+    ArrayInput short_buffer(data.data(), data.size() / 2);
+    EXPECT_FALSE(col.Load(&short_buffer, items_count));
+    EXPECT_EQ(0u, col.Size());
+    col.Append("a");
+    EXPECT_EQ("a", col.At(0));
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityString_AppendAfterLoad) {
+    const size_t items_count = 10;
+    ColumnLowCardinalityT<ColumnString> col;
+
+    const auto & data = LOWCARDINALITY_STRING_FOOBAR_10_ITEMS_BINARY;
+    ArrayInput buffer(data.data(), data.size());
+    ASSERT_TRUE(col.Load(&buffer, items_count));
+    const size_t dictionary_size = col.GetDictionarySize();
+
+    // Items already in the loaded dictionary are found there.
+    col.Append(FooBarSeq(0));
+    col.Append(FooBarSeq(3));
+    EXPECT_EQ(dictionary_size, col.GetDictionarySize());
+
+    col.Append("new item");
+    EXPECT_EQ(dictionary_size + 1, col.GetDictionarySize());
+
+    ASSERT_EQ(items_count + 3, col.Size());
+    EXPECT_EQ(FooBarSeq(0), col.At(items_count));
+    EXPECT_EQ(FooBarSeq(3), col.At(items_count + 1));
+    EXPECT_EQ("new item", col.At(items_count + 2));
+}
+
+TEST(ColumnsCase, LowCardinalitySerializationAdaptor_Load) {
+    const size_t items_count = 10;
+    LowCardinalitySerializationAdaptor<ColumnString> col;
+
+    const auto & data = LOWCARDINALITY_STRING_FOOBAR_10_ITEMS_BINARY;
+    ArrayInput buffer(data.data(), data.size());
+
+    ASSERT_TRUE(col.Load(&buffer, items_count));
+
+    ASSERT_EQ(items_count, col.Size());
+    for (size_t i = 0; i < items_count; ++i) {
+        EXPECT_EQ(col.At(i), FooBarSeq(i)) << " at pos: " << i;
+    }
+}
+
+TEST(ColumnsCase, ColumnFixedString_Gather) {
+    ColumnFixedString dictionary(3);
+    dictionary.Append("");
+    dictionary.Append("abc");
+    dictionary.Append("de");
+
+    ColumnUInt16 index;
+    for (const uint16_t i : {1, 2, 0, 1}) {
+        index.Append(i);
+    }
+
+    ColumnFixedString col(3);
+    col.Append("xyz");
+    col.Gather(dictionary, index);
+
+    ASSERT_EQ(5u, col.Size());
+    EXPECT_EQ("xyz", col[0]);
+    EXPECT_EQ("abc", col[1]);
+    EXPECT_EQ(std::string("de\0", 3), col[2]);
+    EXPECT_EQ(std::string(3, '\0'), col[3]);
+    EXPECT_EQ("abc", col[4]);
+
+    index.Append(3);
+    EXPECT_THROW(col.Gather(dictionary, index), ValidationError);
+    EXPECT_EQ(5u, col.Size());
+
+    ColumnFixedString other_size(2);
+    EXPECT_THROW(other_size.Gather(dictionary, index), ValidationError);
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityString_LoadGranules) {
+    const uint64_t need_global_dictionary = 1u << 8;
+    const uint64_t has_additional_keys = 1u << 9;
+    const uint64_t need_update_dictionary = 1u << 10;
+
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        const auto write_keys = [&output](const std::vector<std::string> & keys) {
+            WireFormat::WriteFixed<uint64_t>(output, keys.size());
+            for (const auto & key : keys)
+                WireFormat::WriteString(output, key);
+        };
+        const auto write_index = [&output](const std::vector<uint8_t> & index) {
+            WireFormat::WriteFixed<uint64_t>(output, index.size());
+            for (const auto i : index)
+                WireFormat::WriteFixed(output, i);
+        };
+
+        // Key serialization version.
+        WireFormat::WriteFixed<uint64_t>(output, 1);
+
+        // Global dictionary and additional keys, which are numbered after it.
+        WireFormat::WriteFixed<uint64_t>(output, need_global_dictionary | has_additional_keys | need_update_dictionary);
+        write_keys({"", "a", "b"});
+        write_keys({"c"});
+        write_index({1, 3, 2});
+
+        // Same global dictionary.
+        WireFormat::WriteFixed<uint64_t>(output, need_global_dictionary);
+        write_index({2, 0});
+
+        // Keys of its own only.
+        WireFormat::WriteFixed<uint64_t>(output, has_additional_keys);
+        write_keys({"", "d"});
+        write_index({1});
+
+        output.Flush();
+    }
+
+    ColumnLowCardinalityT<ColumnString> col;
+    ArrayInput input(data.data(), data.size());
+    ASSERT_TRUE(col.Load(&input, 6));
+    EXPECT_TRUE(input.Exhausted());
+
+    const std::vector<std::string> expected = {"a", "c", "b", "b", "", "d"};
+    ASSERT_EQ(expected.size(), col.Size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i], col.At(i)) << " at pos: " << i;
+    }
+
+    // Granules with more rows than the column has are rejected.
+    ArrayInput short_input(data.data(), data.size());
+    EXPECT_FALSE(col.Load(&short_input, 2));
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityNullableString_LoadGranules) {
+    const uint64_t has_additional_keys = 1u << 9;
+
+    // Keys of each granule have NULL at position 0.
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        WireFormat::WriteFixed<uint64_t>(output, 1);
+        for (const auto & key : {"a", "b"}) {
+            WireFormat::WriteFixed<uint64_t>(output, has_additional_keys);
+            WireFormat::WriteFixed<uint64_t>(output, 2);
+            WireFormat::WriteString(output, "");
+            WireFormat::WriteString(output, key);
+            WireFormat::WriteFixed<uint64_t>(output, 2);
+            WireFormat::WriteFixed<uint8_t>(output, 1);
+            WireFormat::WriteFixed<uint8_t>(output, 0);
+        }
+        output.Flush();
+    }
+
+    auto col = CreateColumnByType("LowCardinality(Nullable(String))")->As<ColumnLowCardinality>();
+    ASSERT_NE(nullptr, col);
+
+    ArrayInput input(data.data(), data.size());
+    ASSERT_TRUE(col->Load(&input, 4));
+    EXPECT_TRUE(input.Exhausted());
+
+    // NULL of all the granules is the one at position 0 of the dictionary.
+    EXPECT_EQ(3u, col->GetDictionarySize());
+    const auto check_items = [](const ColumnLowCardinality & c) {
+        ASSERT_EQ(4u, c.Size());
+        EXPECT_EQ("a", c.GetItem(0).get<std::string_view>());
+        EXPECT_EQ(Type::Void, c.GetItem(1).type);
+        EXPECT_EQ("b", c.GetItem(2).get<std::string_view>());
+        EXPECT_EQ(Type::Void, c.GetItem(3).type);
+    };
+    check_items(*col);
+    check_items(*col->Slice(0, 4)->As<ColumnLowCardinality>());
+
+    // NULLs are saved as NULLs.
+    Buffer saved;
+    {
+        BufferOutput output(&saved);
+        col->Save(&output);
+        output.Flush();
+    }
+    auto loaded = CreateColumnByType("LowCardinality(Nullable(String))")->As<ColumnLowCardinality>();
+    ArrayInput saved_input(saved.data(), saved.size());
+    ASSERT_TRUE(loaded->Load(&saved_input, 4));
+    check_items(*loaded);
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityString_LoadIndexOutOfDictionary) {
+    const uint64_t has_additional_keys = 1u << 9;
+
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        // Key serialization version.
+        WireFormat::WriteFixed<uint64_t>(output, 1);
+
+        // The only granule, with keys of its own, refers past the end of them.
+        WireFormat::WriteFixed<uint64_t>(output, has_additional_keys);
+        WireFormat::WriteFixed<uint64_t>(output, 2);
+        WireFormat::WriteString(output, "");
+        WireFormat::WriteString(output, "a");
+        WireFormat::WriteFixed<uint64_t>(output, 2);
+        WireFormat::WriteFixed<uint8_t>(output, 1);
+        WireFormat::WriteFixed<uint8_t>(output, 2);
+
+        output.Flush();
+    }
+
+    ColumnLowCardinalityT<ColumnString> col;
+    col.Append("b");
+    ArrayInput input(data.data(), data.size());
+    EXPECT_FALSE(col.Load(&input, 2));
+    EXPECT_EQ(0u, col.Size());
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityString_Slice) {
+    const std::vector<std::string> values = {"a", "b", "", "c", "b", "a", "d"};
+    ColumnLowCardinalityT<ColumnString> col;
+    col.AppendMany(values);
+
+    auto slice = col.Slice(1, 4)->As<ColumnLowCardinalityT<ColumnString>>();
+    ASSERT_NE(nullptr, slice);
+    ASSERT_EQ(4u, slice->Size());
+    for (size_t i = 0; i < slice->Size(); ++i) {
+        EXPECT_EQ(values[i + 1], (*slice)[i]) << " at pos: " << i;
+    }
+
+    // Dictionary is compacted to the null-item, "b" and "c".
+    EXPECT_EQ(3u, slice->GetDictionarySize());
+
+    // Items of the slice are found in its dictionary.
+    slice->Append("c");
+    slice->Append("");
+    slice->Append("e");
+    EXPECT_EQ(4u, slice->GetDictionarySize());
+    EXPECT_EQ("c", slice->At(4));
+    EXPECT_EQ("", slice->At(5));
+    EXPECT_EQ("e", slice->At(6));
+
+    EXPECT_EQ(0u, col.Slice(3, 0)->Size());
+    EXPECT_EQ(2u, col.Slice(5, 100)->Size());
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityNullable_Slice) {
+    ColumnLowCardinality nulls(std::make_shared<ColumnNullable>(
+            std::make_shared<ColumnUInt64>(std::vector<uint64_t>{0, 7}),
+            std::make_shared<ColumnUInt8>(std::vector<uint8_t>{1, 0})));
+    ASSERT_EQ(2u, nulls.Size());
+    EXPECT_EQ(Type::Void, nulls.GetItem(0).type);
+
+    auto slice = nulls.Slice(0, 2)->As<ColumnLowCardinality>();
+    ASSERT_EQ(2u, slice->Size());
+    EXPECT_EQ(Type::Void, slice->GetItem(0).type);
+    EXPECT_EQ(7u, slice->GetItem(1).get<uint64_t>());
+
+    slice = nulls.Slice(1, 1)->As<ColumnLowCardinality>();
+    ASSERT_EQ(1u, slice->Size());
+    EXPECT_EQ(7u, slice->GetItem(0).get<uint64_t>());
+    EXPECT_EQ(2u, slice->GetDictionarySize());
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityUInt32_SaveLoad) {
+    const std::vector<uint32_t> values = {7, 0, 7, 42, 0, 1000000};
+    ColumnLowCardinalityT<ColumnUInt32> col;
+    col.AppendMany(values);
+
+    // 0 is the default item at position 0.
+    EXPECT_EQ(4u, col.GetDictionarySize());
+
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        col.Save(&output);
+        output.Flush();
+    }
+
+    ColumnLowCardinalityT<ColumnUInt32> loaded;
+    ArrayInput input(data.data(), data.size());
+    ASSERT_TRUE(loaded.Load(&input, values.size()));
+
+    ASSERT_EQ(values.size(), loaded.Size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(values[i], loaded[i]) << " at pos: " << i;
+    }
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityDate_Append) {
+    ColumnLowCardinalityT<ColumnDate> col;
+    const std::time_t day = 86400;
+    col.Append(day * 100);
+    col.Append(0);
+    col.Append(day * 100);
+
+    EXPECT_EQ(2u, col.GetDictionarySize());
+    ASSERT_EQ(3u, col.Size());
+    EXPECT_EQ(day * 100, col.At(0));
+    EXPECT_EQ(0, col.At(1));
+    EXPECT_EQ(day * 100, col.At(2));
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityNullableString_LoadSave) {
+    const uint64_t has_additional_keys = 1u << 9;
+
+    // Keys of Nullable dictionary are serialized without null map, position 0 is NULL.
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        WireFormat::WriteFixed<uint64_t>(output, 1);
+        WireFormat::WriteFixed<uint64_t>(output, has_additional_keys);
+        WireFormat::WriteFixed<uint64_t>(output, 3);
+        for (const auto & key : {"", "a", "b"})
+            WireFormat::WriteString(output, key);
+        WireFormat::WriteFixed<uint64_t>(output, 4);
+        for (const uint8_t index : {1, 0, 2, 1})
+            WireFormat::WriteFixed(output, index);
+        output.Flush();
+    }
+
+    auto col = CreateColumnByType("LowCardinality(Nullable(String))")->As<ColumnLowCardinality>();
+    ASSERT_NE(nullptr, col);
+
+    ArrayInput input(data.data(), data.size());
+    ASSERT_TRUE(col->Load(&input, 4));
+
+    ASSERT_EQ(4u, col->Size());
+    EXPECT_EQ("a", col->GetItem(0).get<std::string_view>());
+    EXPECT_EQ(Type::Void, col->GetItem(1).type);
+    EXPECT_EQ("b", col->GetItem(2).get<std::string_view>());
+    EXPECT_EQ("a", col->GetItem(3).get<std::string_view>());
+
+    // Appended NULL refers to position 0, and the column is saved as it was loaded.
+    col->Append(col->Slice(1, 1));
+    EXPECT_EQ(Type::Void, col->GetItem(4).type);
+
+    Buffer saved;
+    {
+        BufferOutput output(&saved);
+        col->Slice(0, 4)->Save(&output);
+        output.Flush();
+    }
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()),
+              std::string_view(reinterpret_cast<const char*>(saved.data()), saved.size()));
+
+    // Same data is read into plain Nullable(String) column.
+    auto wrapped = CreateColumnByType("LowCardinality(Nullable(String))", {/*.low_cardinality_as_wrapped_column = */ true})
+            ->As<ColumnNullable>();
+    ASSERT_NE(nullptr, wrapped);
+
+    ArrayInput wrapped_input(data.data(), data.size());
+    ASSERT_TRUE(wrapped->Load(&wrapped_input, 4));
+
+    ASSERT_EQ(4u, wrapped->Size());
+    EXPECT_FALSE(wrapped->IsNull(0));
+    EXPECT_TRUE(wrapped->IsNull(1));
+    EXPECT_EQ("b", wrapped->Nested()->As<ColumnString>()->At(2));
+}
+
+TEST(ColumnsCase, CreateColumnByType_LowCardinality) {
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(UInt32)")->As<ColumnLowCardinalityT<ColumnUInt32>>());
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(Float64)")->As<ColumnLowCardinalityT<ColumnFloat64>>());
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(Date)")->As<ColumnLowCardinalityT<ColumnDate>>());
+    EXPECT_EQ("UTC", CreateColumnByType("LowCardinality(DateTime('UTC'))")
+            ->As<ColumnLowCardinalityT<ColumnDateTime>>()->GetNestedType()->As<DateTimeType>()->Timezone());
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(Nullable(UInt64))")->As<ColumnLowCardinality>());
+    EXPECT_THROW(CreateColumnByType("LowCardinality(Nullable(Array(String)))"), UnimplementedError);
+
+    const CreateColumnByTypeSettings wrapped{/*.low_cardinality_as_wrapped_column = */ true};
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(UInt32)", wrapped)->As<ColumnUInt32>());
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(Date)", wrapped)->As<ColumnDate>());
+    EXPECT_NE(nullptr, CreateColumnByType("LowCardinality(Nullable(String))", wrapped)->As<ColumnNullable>());
+}
+
+TEST(ColumnsCase, LowCardinalitySerializationAdaptor_UInt32) {
+    auto col = CreateColumnByType("LowCardinality(UInt32)", {/*.low_cardinality_as_wrapped_column = */ true})
+            ->As<ColumnUInt32>();
+    ASSERT_NE(nullptr, col);
+    for (const uint32_t value : {5, 5, 0, 9})
+        col->Append(value);
+
+    Buffer data;
+    {
+        BufferOutput output(&data);
+        col->Save(&output);
+        output.Flush();
+    }
+
+    ColumnLowCardinalityT<ColumnUInt32> lc;
+    ArrayInput input(data.data(), data.size());
+    ASSERT_TRUE(lc.Load(&input, col->Size()));
+    EXPECT_EQ(3u, lc.GetDictionarySize());
+
+    auto loaded = CreateColumnByType("LowCardinality(UInt32)", {/*.low_cardinality_as_wrapped_column = */ true});
+    ArrayInput loaded_input(data.data(), data.size());
+    ASSERT_TRUE(loaded->Load(&loaded_input, col->Size()));
+
+    ASSERT_EQ(col->Size(), loaded->Size());
+    for (size_t i = 0; i < col->Size(); ++i) {
+        EXPECT_EQ(col->At(i), lc[i]) << " at pos: " << i;
+        EXPECT_EQ(col->At(i), loaded->As<ColumnUInt32>()->At(i)) << " at pos: " << i;
+    }
+}
+
 // This is temporary diabled since we are not 100% compatitable with ClickHouse
 // on how we serailize LC columns, but we check interoperability in other tests (see client_ut.cpp)
 TEST(ColumnsCase, DISABLED_ColumnLowCardinalityString_Save) {
@@ -879,6 +1422,103 @@ TEST(ColumnsCase, ColumnLowCardinalityString_SaveAndLoad) {
     }
 }
 
+TEST(ColumnsCase, LowCardinalityUniqueItems_Collisions) {
+    // All items have the same hash, so they are told apart by comparing values.
+    const std::vector<std::string> values = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+    details::LowCardinalityUniqueItems items;
+    const auto find_or_insert = [&](const std::string & value, size_t position) {
+        return items.FindOrInsert(42, position, [&](size_t pos) { return values[pos] == value; });
+    };
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(std::make_pair(i, true), find_or_insert(values[i], i));
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(std::make_pair(i, false), find_or_insert(values[i], 100));
+    }
+    EXPECT_EQ(values.size(), items.Size());
+
+    items.EraseLastInserted();
+    EXPECT_EQ(std::make_pair(size_t(9), true), find_or_insert(values[9], 9));
+
+    items.Clear();
+    EXPECT_EQ(0u, items.Size());
+    EXPECT_EQ(std::make_pair(size_t(3), true), find_or_insert(values[3], 3));
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityString_AppendManyAndColumn) {
+    const auto items = GenerateVector(1000, [](size_t i) { return "item" + std::to_string(i % 30); });
+
+    ColumnLowCardinalityT<ColumnString> col;
+    col.AppendMany(items);
+    ASSERT_EQ(items.size(), col.Size());
+    EXPECT_EQ(30u + 1, col.GetDictionarySize());
+
+    auto other = std::make_shared<ColumnLowCardinalityT<ColumnString>>();
+    other->Append("item5");
+    other->Append("other");
+    other->Append(col.Slice(0, 100));
+    col.Append(other);
+
+    ASSERT_EQ(items.size() + 102, col.Size());
+    EXPECT_EQ(31u + 1, col.GetDictionarySize());
+    for (size_t i = 0; i < items.size(); ++i) {
+        ASSERT_EQ(items[i], col.At(i)) << " at pos: " << i;
+    }
+    EXPECT_EQ("item5", col.At(items.size()));
+    EXPECT_EQ("other", col.At(items.size() + 1));
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_EQ(items[i], col.At(items.size() + 2 + i)) << " at pos: " << i;
+    }
+}
+
+TEST(ColumnsCase, ColumnLowCardinalityString_IndexWidth) {
+    // Type of index is written right after the key serialization version.
+    const auto saved_index_type = [](ColumnLowCardinality & col) {
+        Buffer buffer;
+        BufferOutput output(&buffer);
+        col.Save(&output);
+        return buffer.at(sizeof(uint64_t));
+    };
+
+    ColumnLowCardinalityT<ColumnString> col;
+    std::vector<std::string> items;
+    for (size_t i = 0; i < 255; ++i) {
+        items.push_back("item" + std::to_string(i));
+        col.Append(items.back());
+    }
+    // 255 unique items and the null-item fit UInt8 index.
+    EXPECT_EQ(0u, saved_index_type(col));
+
+    items.push_back("item255");
+    col.Append(items.back());
+    EXPECT_EQ(1u, saved_index_type(col));
+
+    for (size_t i = 0; i < 1000; ++i) {
+        items.push_back(items[i % items.size()]);
+        col.Append(items.back());
+    }
+
+    Buffer buffer;
+    {
+        BufferOutput output(&buffer);
+        col.Save(&output);
+    }
+    ColumnLowCardinalityT<ColumnString> loaded;
+    ArrayInput input(buffer.data(), buffer.size());
+    ASSERT_TRUE(loaded.Load(&input, items.size()));
+    for (size_t i = 0; i < items.size(); ++i) {
+        ASSERT_EQ(items[i], loaded.At(i)) << " at pos: " << i;
+    }
+
+    col.Clear();
+    col.Append("item");
+    EXPECT_EQ(0u, saved_index_type(col));
+    // The index kept from before Clear() is narrowed on each Save(), the column itself is left as is.
+    EXPECT_EQ(0u, saved_index_type(col));
+    EXPECT_EQ("item", col.At(0));
+}
+
 TEST(ColumnsCase, ColumnLowCardinalityString_WithEmptyString_1) {
     // Verify that when empty string is added to a LC column it can be retrieved back as empty string.
     ColumnLowCardinalityT<ColumnString> col;
@@ -953,6 +1593,34 @@ TEST(ColumnsCase, LowCardinalityAsWrappedColumn) {
     ASSERT_EQ(Type::FixedString, CreateColumnByType("LowCardinality(FixedString(10000))", create_column_settings)->As<ColumnFixedString>()->GetType().GetCode());
 }
 
+TEST(ColumnsCase, CloneEmpty) {
+    auto nested = std::make_shared<ColumnFixedString>(3);
+    nested->Append("abc");
+    nested->Append("xyz");
+    auto nulls = std::make_shared<ColumnUInt8>(std::vector<uint8_t>{0, 1});
+    auto col = std::make_shared<ColumnArray>(std::make_shared<ColumnNullable>(nested, nulls));
+    col->OffsetsIncrease(2);
+
+    auto clone = col->CloneEmpty()->As<ColumnArray>();
+    ASSERT_NE(nullptr, clone);
+    EXPECT_EQ(0u, clone->Size());
+    EXPECT_EQ(col->Type(), clone->Type());
+
+    clone->AppendAsColumn(col->GetAsColumn(0));
+    ASSERT_EQ(1u, clone->Size());
+    EXPECT_EQ(1u, col->Size());
+    EXPECT_EQ("abc", clone->GetAsColumn(0)->As<ColumnNullable>()->Nested()->As<ColumnFixedString>()->At(0));
+
+    ColumnLowCardinalityT<ColumnString> lc;
+    lc.Append("abc");
+    auto lc_clone = lc.CloneEmpty()->As<ColumnLowCardinalityT<ColumnString>>();
+    ASSERT_NE(nullptr, lc_clone);
+    EXPECT_EQ(0u, lc_clone->Size());
+    lc_clone->Append("xyz");
+    EXPECT_EQ("xyz", (*lc_clone)[0]);
+    EXPECT_EQ("abc", lc[0]);
+}
+
 TEST(ColumnsCase, ArrayOfDecimal) {
     auto column = std::make_shared<clickhouse::ColumnDecimal>(18, 10);
     auto array = std::make_shared<clickhouse::ColumnArray>(column->Slice(0, 0));
@@ -977,6 +1645,18 @@ TEST_P(ColumnsCaseWithName, CreateColumnByType)
     EXPECT_EQ(col->GetType().GetName(), GetParam());
 }
 
+TEST_P(ColumnsCaseWithName, CreateColumnByTypeSharesType)
+{
+    const auto col = CreateColumnByType(GetParam());
+    const auto other = CreateColumnByType(GetParam());
+    ASSERT_NE(nullptr, other);
+    EXPECT_NE(col, other);
+    EXPECT_EQ(col->Type(), other->Type());
+
+    const auto clone = other->CloneEmpty();
+    EXPECT_EQ(other->Type(), clone->Type());
+}
+
 INSTANTIATE_TEST_SUITE_P(Basic, ColumnsCaseWithName, ::testing::Values(
     "Int8", "Int16", "Int32", "Int64",
     "UInt8", "UInt16", "UInt32", "UInt64",
@@ -1,9 +1,16 @@
+#include <clickhouse/base/compressed.h>
 #include <clickhouse/base/wire_format.h>
 #include <clickhouse/base/output.h>
+#include <clickhouse/base/thread_pool.h>
 #include <clickhouse/base/input.h>
+#include <clickhouse/exceptions.h>
 
 #include <gtest/gtest.h>
 
+#include <city.h>
+
+#include <algorithm>
+
 using namespace clickhouse;
 
 TEST(CodedStreamCase, Varint64) {
@@ -22,3 +29,338 @@ TEST(CodedStreamCase, Varint64) {
         ASSERT_EQ(value, 18446744071965638648ULL);
     }
 }
+
+namespace {
+
+std::string MakeTestData(size_t size) {
+    std::string data;
+    data.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        data.push_back(static_cast<char>('a' + (i * 7 + i / 13) % 26));
+    }
+    return data;
+}
+
+std::string ReadAll(InputStream& input, size_t size) {
+    std::string result(size, '\0');
+    EXPECT_TRUE(WireFormat::ReadBytes(input, result.data(), size));
+    return result;
+}
+
+/// Appends compressed frames of the data to the buffer.
+void WriteCompressed(Buffer* buf, const std::string& data, CompressionMethod method) {
+    Buffer frames;
+    {
+        BufferOutput output(&frames);
+        CompressedOutput compressed(&output, 1000, method);
+        compressed.Write(data.data(), data.size());
+        compressed.Flush();
+    }
+    buf->insert(buf->end(), frames.begin(), frames.end());
+}
+
+}
+
+TEST(BufferedInputCase, Peek) {
+    const std::string data = MakeTestData(100);
+    BufferedInput input(std::make_unique<ArrayInput>(data.data(), data.size()), 8);
+
+    const void* ptr = nullptr;
+    ASSERT_EQ(8u, input.Peek(&ptr, 1));
+    input.Consume(6);
+
+    // The rest of the buffer is moved to its start, and the buffer grows to fit the data requested.
+    ASSERT_EQ(20u, input.Peek(&ptr, 20));
+    EXPECT_EQ(data.substr(6, 20), std::string(static_cast<const char*>(ptr), 20));
+    input.Consume(20);
+
+    EXPECT_EQ(data.substr(26, 10), ReadAll(input, 10));
+
+    // Less data than requested is left in the stream.
+    ASSERT_EQ(64u, input.Peek(&ptr, 1000));
+    input.Consume(64);
+    EXPECT_EQ(0u, input.Peek(&ptr, 1));
+}
+
+TEST(BufferedInputCase, WireFormatAcrossBuffers) {
+    Buffer buf;
+    {
+        BufferOutput output(&buf);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            WireFormat::WriteUInt64(output, i * i * i * 1000003);
+            WireFormat::WriteFixed<uint32_t>(output, static_cast<uint32_t>(i));
+            WireFormat::WriteString(output, MakeTestData(i % 200));
+        }
+        output.Flush();
+    }
+
+    for (size_t buffer_size : {1, 3, 16, 8192}) {
+        SCOPED_TRACE(buffer_size);
+
+        BufferedInput input(std::make_unique<ArrayInput>(buf.data(), buf.size()), buffer_size);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            uint64_t varint = 0;
+            uint32_t fixed = 0;
+            std::string str;
+            ASSERT_TRUE(WireFormat::ReadUInt64(input, &varint));
+            ASSERT_TRUE(WireFormat::ReadFixed(input, &fixed));
+            ASSERT_TRUE(WireFormat::ReadString(input, &str));
+            ASSERT_EQ(i * i * i * 1000003, varint);
+            ASSERT_EQ(i, fixed);
+            ASSERT_EQ(MakeTestData(i % 200), str);
+        }
+
+        uint64_t varint = 0;
+        EXPECT_FALSE(WireFormat::ReadUInt64(input, &varint));
+    }
+}
+
+TEST(CompressedStreamCase, LZ4RoundTrip) {
+    const auto data = MakeTestData(10000);
+    Buffer buf;
+    WriteCompressed(&buf, data, CompressionMethod::LZ4);
+    EXPECT_GT(data.size(), buf.size());
+
+    ArrayInput input(buf.data(), buf.size());
+    CompressedInput compressed(&input);
+    EXPECT_EQ(data, ReadAll(compressed, data.size()));
+}
+
+TEST(CompressedStreamCase, ParallelCompression) {
+    const auto data = MakeTestData(100000);
+
+    // Same frames are produced regardless of the number of threads compressing them.
+    Buffer sequential;
+    {
+        BufferOutput output(&sequential);
+        CompressedOutput compressed(&output, 1000);
+        compressed.Write(data.data(), data.size());
+        compressed.Flush();
+    }
+
+    ThreadPool pool(4);
+    Buffer parallel;
+    {
+        BufferOutput output(&parallel);
+        CompressedOutput compressed(&output, 1000, CompressionMethod::LZ4, 0, &pool);
+        compressed.Write(data.data(), data.size());
+        compressed.Write(data.data(), 500);
+        compressed.Flush();
+    }
+    ASSERT_LT(sequential.size(), parallel.size());
+    EXPECT_TRUE(std::equal(sequential.begin(), sequential.end(), parallel.begin()));
+
+    ArrayInput input(parallel.data(), parallel.size());
+    CompressedInput compressed(&input);
+    EXPECT_EQ(data, ReadAll(compressed, data.size()));
+    EXPECT_EQ(data.substr(0, 500), ReadAll(compressed, 500));
+}
+
+TEST(CompressedStreamCase, BufferedSource) {
+    // Small frames fit the buffer of BufferedInput and are decompressed in place,
+    // large ones are read into the buffer of CompressedInput.
+    const auto small = MakeTestData(1000);
+    const auto large = MakeTestData(50000);
+
+    Buffer buf;
+    for (int i = 0; i < 10; ++i) {
+        WriteCompressed(&buf, small, CompressionMethod::LZ4);
+        {
+            Buffer frames;
+            BufferOutput output(&frames);
+            CompressedOutput compressed(&output, 0);
+            compressed.Write(large.data(), large.size());
+            compressed.Flush();
+            buf.insert(buf.end(), frames.begin(), frames.end());
+        }
+    }
+
+    BufferedInput input(std::make_unique<ArrayInput>(buf.data(), buf.size()), 4096);
+    CompressedInput compressed(&input);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(small, ReadAll(compressed, small.size()));
+        EXPECT_TRUE(compressed.Exhausted());
+        EXPECT_EQ(large, ReadAll(compressed, large.size()));
+        EXPECT_TRUE(compressed.Exhausted());
+    }
+
+    const void* ptr = nullptr;
+    EXPECT_EQ(0u, compressed.Next(&ptr, 1));
+}
+
+TEST(CompressedStreamCase, ReadAhead) {
+    // Blocks of frames are interleaved with uncompressed data, which read-ahead must leave intact.
+    const std::string marker = "not a frame";
+    std::vector<std::string> blocks;
+    Buffer buf;
+    for (size_t i = 0; i < 20; ++i) {
+        blocks.push_back(MakeTestData(500 + i * 997));
+        WriteCompressed(&buf, blocks.back(), CompressionMethod::LZ4);
+        buf.insert(buf.end(), marker.begin(), marker.end());
+    }
+
+    for (size_t buffer_size : {64, 4096, 1 << 20}) {
+        SCOPED_TRACE(buffer_size);
+
+        BufferedInput input(std::make_unique<ArrayInput>(buf.data(), buf.size()), buffer_size);
+        CompressedInput compressed(&input, 3);
+        for (const auto& block : blocks) {
+            EXPECT_EQ(block, ReadAll(compressed, block.size()));
+            EXPECT_TRUE(compressed.Exhausted());
+
+            compressed.StopReadAhead();
+            EXPECT_EQ(marker, ReadAll(input, marker.size()));
+        }
+
+        const void* ptr = nullptr;
+        EXPECT_EQ(0u, compressed.Next(&ptr, 1));
+    }
+}
+
+TEST(CompressedStreamCase, UncompressedFrame) {
+    const std::string data = "some data";
+
+    // Frame of method NONE: checksum, method, size with header, original size, data.
+    Buffer frame;
+    {
+        BufferOutput output(&frame);
+        WireFormat::WriteFixed<uint8_t>(output, 0x02);
+        WireFormat::WriteFixed<uint32_t>(output, static_cast<uint32_t>(9 + data.size()));
+        WireFormat::WriteFixed<uint32_t>(output, static_cast<uint32_t>(data.size()));
+        WireFormat::WriteBytes(output, data.data(), data.size());
+        output.Flush();
+    }
+
+    // Mixed with LZ4 frames in the same stream.
+    const auto lz4_data = MakeTestData(3000);
+    Buffer buf;
+    WriteCompressed(&buf, lz4_data, CompressionMethod::LZ4);
+    const uint128 hash = CityHash128(reinterpret_cast<const char*>(frame.data()), frame.size());
+    buf.insert(buf.end(), reinterpret_cast<const uint8_t*>(&hash), reinterpret_cast<const uint8_t*>(&hash) + sizeof(hash));
+    buf.insert(buf.end(), frame.begin(), frame.end());
+
+    ArrayInput input(buf.data(), buf.size());
+    CompressedInput compressed(&input);
+    EXPECT_EQ(lz4_data, ReadAll(compressed, lz4_data.size()));
+    EXPECT_EQ(data, ReadAll(compressed, data.size()));
+}
+
+TEST(CompressedStreamCase, CorruptedFrame) {
+    const auto data = MakeTestData(1000);
+    Buffer buf;
+    WriteCompressed(&buf, data, CompressionMethod::LZ4);
+    buf.back() ^= 0xFF;
+
+    ArrayInput input(buf.data(), buf.size());
+    CompressedInput compressed(&input);
+    std::string result(data.size(), '\0');
+    EXPECT_THROW(WireFormat::ReadBytes(compressed, result.data(), result.size()), CompressionError);
+}
+
+#if defined(WITH_ZSTD)
+TEST(CompressedStreamCase, ZSTDRoundTrip) {
+    const auto data = MakeTestData(10000);
+    Buffer buf;
+    WriteCompressed(&buf, data, CompressionMethod::ZSTD);
+    EXPECT_GT(data.size(), buf.size());
+
+    // LZ4 and ZSTD frames in the same stream.
+    WriteCompressed(&buf, data, CompressionMethod::LZ4);
+
+    ArrayInput input(buf.data(), buf.size());
+    CompressedInput compressed(&input);
+    EXPECT_EQ(data, ReadAll(compressed, data.size()));
+    EXPECT_EQ(data, ReadAll(compressed, data.size()));
+}
+#else
+TEST(CompressedStreamCase, ZSTDNotSupported) {
+    Buffer buf;
+    BufferOutput output(&buf);
+    EXPECT_THROW(CompressedOutput(&output, 1000, CompressionMethod::ZSTD), CompressionError);
+}
+#endif
+
+namespace {
+
+/// Records the data and the number of calls of each kind.
+class RecordingOutput : public OutputStream {
+public:
+    std::string data;
+    size_t writes = 0;
+    size_t vectored_writes = 0;
+
+protected:
+    size_t DoWrite(const void* buf, size_t len) override {
+        ++writes;
+        data.append(static_cast<const char*>(buf), len);
+        return len;
+    }
+
+    size_t DoWriteV(const OutputSegment* segments, size_t count) override {
+        ++vectored_writes;
+        size_t written = 0;
+        for (size_t i = 0; i < count; ++i) {
+            data.append(static_cast<const char*>(segments[i].data), segments[i].size);
+            written += segments[i].size;
+        }
+        return written;
+    }
+};
+
+}
+
+TEST(GatherOutputCase, ReferencedAndBufferedData) {
+    const std::string large = MakeTestData(100000);
+    const std::string small = "header";
+
+    auto destination = std::make_unique<RecordingOutput>();
+    auto& recording = *destination;
+    GatherOutput output(std::move(destination), 64);
+
+    std::string expected;
+    for (size_t i = 0; i < 3; ++i) {
+        WireFormat::WriteString(output, small);
+        WireFormat::WriteBytesRef(output, large.data(), large.size());
+        // Small data is copied even if it could be referenced.
+        WireFormat::WriteBytesRef(output, small.data(), small.size());
+        WireFormat::WriteUInt64(output, i);
+
+        expected.push_back(static_cast<char>(small.size()));
+        expected += small + large + small;
+        expected.push_back(static_cast<char>(i));
+    }
+    output.Flush();
+
+    EXPECT_EQ(expected, recording.data);
+    EXPECT_EQ(0u, recording.writes);
+    EXPECT_EQ(1u, recording.vectored_writes);
+
+    // Without referenced data, the buffer is written as is.
+    WireFormat::WriteString(output, small);
+    output.Flush();
+
+    EXPECT_EQ(expected + static_cast<char>(small.size()) + small, recording.data);
+    EXPECT_EQ(1u, recording.writes);
+    EXPECT_EQ(1u, recording.vectored_writes);
+}
+
+TEST(CopyingOutputCase, ReferencedDataIsCopied) {
+    std::string temporary = MakeTestData(100000);
+    const std::string expected = temporary;
+
+    auto destination = std::make_unique<RecordingOutput>();
+    auto& recording = *destination;
+    GatherOutput output(std::move(destination), 2 * expected.size());
+    {
+        CopyingOutput copying_output(&output);
+        WireFormat::WriteBytesRef(copying_output, temporary.data(), temporary.size());
+        copying_output.Flush();
+    }
+    EXPECT_TRUE(recording.data.empty());
+
+    // The data may change before the output is flushed.
+    temporary.assign(temporary.size(), 'x');
+    output.Flush();
+
+    EXPECT_EQ(expected, recording.data);
+}
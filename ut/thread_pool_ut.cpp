@@ -0,0 +1,46 @@
+#include <clickhouse/base/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace clickhouse;
+
+TEST(ThreadPoolCase, RunsEveryTask) {
+    ThreadPool pool(4);
+    ASSERT_EQ(4u, pool.GetThreadCount());
+
+    for (size_t batch = 0; batch < 100; ++batch) {
+        std::vector<std::atomic<int>> runs(batch);
+        pool.Run(batch, [&runs] (size_t task, size_t thread) {
+            EXPECT_LT(thread, 4u);
+            ++runs[task];
+        });
+
+        for (const auto & r : runs) {
+            EXPECT_EQ(1, r.load());
+        }
+    }
+}
+
+TEST(ThreadPoolCase, RethrowsException) {
+    ThreadPool pool(3);
+    std::atomic<size_t> runs{0};
+
+    EXPECT_THROW(
+        pool.Run(1000, [&runs] (size_t task, size_t) {
+            ++runs;
+            if (task == 10) {
+                throw std::runtime_error("task failed");
+            }
+        }),
+        std::runtime_error);
+    EXPECT_LT(runs.load(), 1000u);
+
+    // Pool is still usable afterwards.
+    runs = 0;
+    pool.Run(10, [&runs] (size_t, size_t) { ++runs; });
+    EXPECT_EQ(10u, runs.load());
+}